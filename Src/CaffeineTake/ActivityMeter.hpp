@@ -0,0 +1,185 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+namespace CaffeineTake {
+
+// Rate of monotonically increasing counter (bytes, operations, ...) over
+// sliding time window. Samples are kept in fixed ring buffer, if window
+// needs more samples than that, it is effectively shorter.
+class RateWindow
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Sample
+    {
+        Clock::time_point  Time  = Clock::time_point();
+        unsigned long long Value = 0;
+    };
+
+    static constexpr auto Capacity = size_t{128};
+
+    std::array<Sample, Capacity> mSamples = std::array<Sample, Capacity>();
+    size_t                       mFirst   = 0;
+    size_t                       mCount   = 0;
+
+public:
+    auto Add (Clock::time_point time, unsigned long long value, Clock::duration window) -> void
+    {
+        if (mCount == Capacity)
+        {
+            mFirst  = (mFirst + 1) % Capacity;
+            mCount -= 1;
+        }
+
+        mSamples[(mFirst + mCount) % Capacity] = Sample{ time, value };
+        mCount += 1;
+
+        // Keep one sample older than window, so rate covers whole window.
+        while (mCount > 2 && time - mSamples[(mFirst + 1) % Capacity].Time >= window)
+        {
+            mFirst  = (mFirst + 1) % Capacity;
+            mCount -= 1;
+        }
+    }
+
+    // Units per second, 0 until there are two samples.
+    auto GetRate () const -> double
+    {
+        if (mCount < 2)
+        {
+            return 0.0;
+        }
+
+        const auto& first = mSamples[mFirst];
+        const auto& last  = mSamples[(mFirst + mCount - 1) % Capacity];
+
+        const auto seconds = std::chrono::duration<double>(last.Time - first.Time).count();
+        if (seconds <= 0.0 || last.Value < first.Value)
+        {
+            return 0.0;
+        }
+
+        return static_cast<double>(last.Value - first.Value) / seconds;
+    }
+
+    auto Clear () -> void
+    {
+        mFirst = 0;
+        mCount = 0;
+    }
+};
+
+// Exponentially weighted moving average of irregularly spaced samples.
+// Weight of sample depends on time since previous one, so average reacts
+// the same no matter how often it's updated. Time constant is the time
+// after which old value weights ~37%.
+class ExponentialAverage
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    Clock::time_point mLastTime = Clock::time_point();
+    double            mValue    = 0.0;
+    bool              mHasValue = false;
+
+public:
+    auto Add (Clock::time_point time, double value, Clock::duration timeConstant) -> double
+    {
+        if (!mHasValue || timeConstant <= Clock::duration::zero())
+        {
+            mValue    = value;
+            mHasValue = true;
+        }
+        else
+        {
+            const auto elapsed = std::chrono::duration<double>(time - mLastTime).count();
+            const auto tau     = std::chrono::duration<double>(timeConstant).count();
+            const auto alpha   = 1.0 - std::exp(-std::max(elapsed, 0.0) / tau);
+
+            mValue += alpha * (value - mValue);
+        }
+
+        mLastTime = time;
+        return mValue;
+    }
+
+    auto GetValue () const -> double
+    {
+        return mValue;
+    }
+
+    auto Clear () -> void
+    {
+        mValue    = 0.0;
+        mHasValue = false;
+    }
+};
+
+// Turns on when value reaches threshold, turns off only when it drops
+// below lower threshold, so value hovering around threshold doesn't flip
+// trigger every tick. Off threshold 0 or above on threshold means no
+// hysteresis, otherwise any sample would keep trigger active.
+class HysteresisThreshold
+{
+    bool mIsActive = false;
+
+public:
+    auto Update (double value, double onThreshold, double offThreshold) -> bool
+    {
+        if (offThreshold <= 0.0 || offThreshold > onThreshold)
+        {
+            offThreshold = onThreshold;
+        }
+
+        if (mIsActive)
+        {
+            mIsActive = value >= offThreshold;
+        }
+        else
+        {
+            mIsActive = value >= onThreshold;
+        }
+
+        return mIsActive;
+    }
+
+    auto IsActive () const -> bool
+    {
+        return mIsActive;
+    }
+
+    auto Reset () -> void
+    {
+        mIsActive = false;
+    }
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,193 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "BluetoothRadio.hpp"
+
+#include "Logger.hpp"
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+#   include <bluetoothapis.h>
+#endif
+
+namespace CaffeineTake {
+
+namespace {
+    // Last seen time reported by the API is in local time.
+    auto LocalSystemTimeToSystemTimePoint (const SYSTEMTIME& st) -> SystemTimePoint
+    {
+        auto ft     = FILETIME{};
+        auto ft_utc = FILETIME{};
+
+        if (SystemTimeToFileTime(&st, &ft))
+        {
+            if (LocalFileTimeToFileTime(&ft, &ft_utc))
+            {
+                return FILETIME_to_system_clock(ft_utc);
+            }
+        }
+
+        return SystemTimePoint();
+    }
+}
+
+#pragma region "WindowsBluetoothRadio"
+
+auto WindowsBluetoothRadio::IsPresent () -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    return false;
+#else
+    auto params = BLUETOOTH_FIND_RADIO_PARAMS{
+        .dwSize = sizeof(BLUETOOTH_FIND_RADIO_PARAMS)
+    };
+
+    auto found = false;
+
+    auto radio = INVALID_HANDLE_VALUE;
+    auto hRadioFind = BluetoothFindFirstRadio(&params, &radio);
+    if (hRadioFind)
+    {
+        CloseHandle(radio);
+        BluetoothFindRadioClose(hRadioFind);
+        found = true;
+
+        // For some reason system keeps loading/unloading this library.
+        // Load manually to keep at least one reference.
+        if (!mLibBluetoothApis)
+        {
+            mLibBluetoothApis = LoadLibraryW(L"bluetoothapis.dll");
+        }
+    }
+
+    return found;
+#endif
+}
+
+auto WindowsBluetoothRadio::Inquiry () -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    return false;
+#else
+    LOG_TRACE("Starting bluetooth device inquiry");
+
+    auto result = true;
+
+    auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
+    ZeroMemory(&deviceInfo, sizeof(deviceInfo));
+    deviceInfo.dwSize = sizeof(deviceInfo);
+
+    auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
+        .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
+        .fReturnAuthenticated = TRUE,
+        .fReturnRemembered    = TRUE,
+        .fReturnUnknown       = TRUE,
+        .fReturnConnected     = TRUE,
+        .fIssueInquiry        = TRUE,
+        .cTimeoutMultiplier   = 1,    // n*1.28s
+        .hRadio               = NULL  // use all radios, for inquiry
+    };
+
+    auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
+    if (deviceFind == NULL)
+    {
+        auto error = GetLastError();
+        if (error != ERROR_NO_MORE_ITEMS)
+        {
+            LOG_DEBUG("Bluetooth inquiry failed with error {}", error);
+            result = false;
+        }
+        else
+        {
+            LOG_DEBUG("Bluetooth inquiry no more items");
+        }
+    }
+    else
+    {
+        BluetoothFindDeviceClose(deviceFind);
+    }
+
+    LOG_TRACE("Finished bluetooth device inqury");
+
+    return result;
+#endif
+}
+
+auto WindowsBluetoothRadio::EnumerateDevices (DeviceFn callback, const StopToken& stop) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    return false;
+#else
+    auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
+    ZeroMemory(&deviceInfo, sizeof(deviceInfo));
+    deviceInfo.dwSize = sizeof(deviceInfo);
+
+    auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
+        .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
+        .fReturnAuthenticated = TRUE,
+        .fReturnRemembered    = TRUE,
+        .fReturnUnknown       = TRUE,
+        .fReturnConnected     = TRUE,
+        .fIssueInquiry        = FALSE,
+        .cTimeoutMultiplier   = 0,
+        .hRadio               = NULL  // use all radios
+    };
+
+    auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
+    if (deviceFind == NULL)
+    {
+        auto error = GetLastError();
+        if (error != ERROR_NO_MORE_ITEMS)
+        {
+            LOG_DEBUG("BluetoothFindFirstDevice() failed with error {}", error);
+            return false;
+        }
+
+        LOG_DEBUG("BluetoothFindFirstDevice() no more items");
+        return true;
+    }
+
+    do
+    {
+        auto record = BluetoothDeviceRecord();
+        record.Id.ull      = deviceInfo.Address.ullLong;
+        record.Name        = std::wstring(deviceInfo.szName);
+        record.IsConnected = deviceInfo.fConnected;
+        record.LastSeen    = LocalSystemTimeToSystemTimePoint(deviceInfo.stLastSeen);
+
+        callback(record);
+
+        if (stop)
+        {
+            break;
+        }
+    } while (BluetoothFindNextDevice(deviceFind, &deviceInfo));
+
+    BluetoothFindDeviceClose(deviceFind);
+
+    return true;
+#endif
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
@@ -0,0 +1,83 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include "BluetoothIdentifier.hpp"
+#include "ThreadTimer.hpp"
+#include "Utility.hpp"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+namespace CaffeineTake {
+
+struct BluetoothDeviceRecord
+{
+    BluetoothIdentifier Id          = BluetoothIdentifier();
+    std::wstring        Name        = L"";
+    bool                IsConnected = false;
+    SystemTimePoint     LastSeen    = SystemTimePoint();
+};
+
+// Access to Bluetooth radio, separated from scanner so inquiry can run on
+// background thread.
+class BluetoothRadio
+{
+public:
+    using DeviceFn = std::function<void (const BluetoothDeviceRecord& device)>;
+
+    virtual ~BluetoothRadio() {}
+
+    virtual auto IsPresent () -> bool = 0;
+
+    // Blocks for the duration of the inquiry (n*1.28s).
+    virtual auto Inquiry () -> bool = 0;
+
+    // Enumerate remembered and connected devices, doesn't issue inquiry.
+    virtual auto EnumerateDevices (DeviceFn callback, const StopToken& stop) -> bool = 0;
+};
+
+class WindowsBluetoothRadio : public BluetoothRadio
+{
+    HMODULE mLibBluetoothApis = NULL;
+
+public:
+    ~WindowsBluetoothRadio ()
+    {
+        if (mLibBluetoothApis)
+        {
+            FreeLibrary(mLibBluetoothApis);
+        }
+    }
+
+    auto IsPresent        () -> bool override;
+    auto Inquiry          () -> bool override;
+    auto EnumerateDevices (DeviceFn callback, const StopToken& stop) -> bool override;
+};
+
+} // namespace CaffeineTake
@@ -38,11 +38,13 @@
 #include <fstream>
 
 #include <commctrl.h>
+#include <Dbt.h>
 #include <Psapi.h>
 #include <shellapi.h>
 #include <ShlObj.h>
 
-#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION)
+#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
 #   include <WtsApi32.h>
 #endif
 
@@ -54,6 +56,18 @@ namespace CaffeineTake {
 constexpr auto CAFFEINE_TAKE_WINDOW_TITLE = L"CaffeineTake_WndClass";
 constexpr auto CAFFEINE_TAKE_CLASS_NAME   = L"CaffeineTake_InvisibleWindow";
 
+// With remote session trigger notifications come for all sessions.
+static auto IsCurrentSession (LPARAM sessionId) -> bool
+{
+    auto current = DWORD{0};
+    if (!ProcessIdToSessionId(GetCurrentProcessId(), &current))
+    {
+        return true;
+    }
+
+    return current == static_cast<DWORD>(sessionId);
+}
+
 CaffeineApp::CaffeineApp (const AppInitInfo& info)
     : mSettings           (std::make_shared<Settings>())
     , mLang               (std::make_shared<Lang>())
@@ -216,9 +230,17 @@ auto CaffeineApp::MainLoop () -> int
 
 auto CaffeineApp::OnCreate() -> void
 {
-#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION)
+#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+#   if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+    // Remote logons happen in other sessions.
+    const auto sessionFlags = NOTIFY_FOR_ALL_SESSIONS;
+#   else
+    const auto sessionFlags = NOTIFY_FOR_THIS_SESSION;
+#   endif
+
     // Add session lock notification event.
-    if (!WTSRegisterSessionNotification(mNotifyIcon.Handle(), NOTIFY_FOR_THIS_SESSION))
+    if (!WTSRegisterSessionNotification(mNotifyIcon.Handle(), sessionFlags))
     {
         LOG_ERROR("Failed to register session notification event");
         LOG_INFO("DisableOnLockScreen functionality will not work");
@@ -229,7 +251,8 @@ auto CaffeineApp::OnCreate() -> void
 auto CaffeineApp::OnDestroy() -> void
 {
     LOG_INFO("Shutting down application");
-#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION)
+#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
     WTSUnRegisterSessionNotification(mNotifyIcon.Handle());
 #endif
 }
@@ -432,6 +455,15 @@ auto CaffeineApp::OnSystemMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) -> bo
     switch (uMsg)
     {
     case WM_WTSSESSION_CHANGE:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+        mAutoMode.OnSessionChange();
+#endif
+
+        if (!IsCurrentSession(lParam))
+        {
+            break;
+        }
+
         switch (wParam)
         {
         case WTS_SESSION_LOCK:
@@ -448,6 +480,31 @@ auto CaffeineApp::OnSystemMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) -> bo
         }
 
         break;
+
+    case WM_POWERBROADCAST:
+        if (wParam == PBT_APMRESUMEAUTOMATIC)
+        {
+            LOG_INFO("Resumed from sleep");
+            mAutoMode.InvalidateScanners();
+        }
+        else if (wParam == PBT_APMPOWERSTATUSCHANGE)
+        {
+            mAutoMode.OnPowerSourceChange();
+        }
+
+        break;
+
+    case WM_DEVICECHANGE:
+        if (wParam == DBT_DEVNODES_CHANGED)
+        {
+            mAutoMode.OnDeviceChange();
+        }
+
+        break;
+
+    case WM_TIMECHANGE:
+        mAutoMode.OnTimeChange();
+        break;
     }
 
     return false;
@@ -1090,7 +1147,8 @@ auto CaffeineApp::ShowSettingsDialog () -> bool
         mSettings->Standard = newSettings.Standard;
         mSettings->Auto     = newSettings.Auto;
 
-        // TODO in future settings change might change auto mode refresh interval, so update timer settings        
+        // Scan interval is picked up on next tick, rule needs recompiling.
+        mAutoMode.OnSettingsChange();
 
         // Settings change don't trigger caffeine state to change,
         // but display settings might change so we need to update.
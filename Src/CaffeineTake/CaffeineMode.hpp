@@ -22,14 +22,23 @@
 
 #include "CaffeineAppSO.hpp"
 #include "CaffeineState.hpp"
+#include "Debouncer.hpp"
 #include "ForwardDeclaration.hpp"
+#include "IdleTimeSource.hpp"
+#include "LocalTimeCache.hpp"
+#include "RuleExpression.hpp"
 #include "Scanner.hpp"
 #include "Schedule.hpp"
 #include "ThreadTimer.hpp"
 
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace CaffeineTake {
 
@@ -103,21 +112,164 @@ class AutoMode : public Mode
 
     ProcessScanner     mProcessScanner;
     WindowScanner      mWindowScanner;
+    FullscreenScanner  mFullscreenScanner;
     UsbDeviceScanner   mUsbScanner;
     BluetoothScanner   mBluetoothScanner;
+    NetworkScanner     mNetworkScanner;
+    DiskScanner        mDiskScanner;
+    CpuScanner         mCpuScanner;
+    TcpScanner         mTcpScanner;
+    DirectoryScanner   mDirectoryScanner;
+    RemoteSessionScanner mRemoteSessionScanner;
+    JobScanner         mJobScanner;
+    PidFileScanner     mPidFileScanner;
 
     ThreadTimer        mScannerTimer;
     ThreadTimer        mScheduleTimer;
 
+    std::unique_ptr<IdleTimeSource> mIdleSource;
+    std::atomic<unsigned long long> mScanTicks;
+    std::atomic<unsigned long long> mSkippedScans;
+    std::atomic<bool>               mIsOnBattery;
+    std::vector<Scanner*>           mScanOrder;  // cheapest per hit first
+    std::vector<std::wstring>       mPriorityTriggers;
+
+    using ScanClock = std::chrono::steady_clock;
+
+    // Per trigger scan state, scanners run on their own interval on the
+    // shared scanner timer.
+    struct ScanSlot
+    {
+        ScanClock::time_point NextScan = ScanClock::time_point();
+        bool                  Result   = false;
+        std::atomic<bool>     Changed  = true;   // source reported change, scan on next tick
+    };
+
+    struct TriggerConfig
+    {
+        bool         Enabled      = false;
+        unsigned int ScanInterval = 0;
+    };
+
+    std::unordered_map<const Scanner*, ScanSlot> mScanSlots;  // not modified after construction
+
+    // Each thread has its own, delays are applied to scanner and schedule
+    // result before they change Auto mode state.
+    Debouncer                       mScannerDebouncer;
+    Debouncer                       mScheduleDebouncer;
+
+    // Rule predicate bound to scanner. Predicates without arguments use
+    // scanners above, others own scanner with arguments applied to copy of
+    // settings. Scanned on interval of its trigger like without rule, scan
+    // state is used only by scanner thread.
+    struct RuleTerm
+    {
+        Scanner*                  Target     = nullptr;
+        std::unique_ptr<Scanner>  Owned      = nullptr;
+        SettingsPtr               Settings   = nullptr;
+        bool                      IsSchedule = false;
+        CompiledSchedule          Schedule   = CompiledSchedule();
+        TriggerConfig             Config     = TriggerConfig();
+        ScanClock::time_point     NextScan   = ScanClock::time_point();
+        bool                      Result     = false;
+        bool                      Changed    = true;   // source reported change or scanner was invalidated
+    };
+
+    RuleExpression                  mRule;
+    std::vector<RuleTerm>           mRuleTerms;
+    std::wstring                    mRuleText;
+    std::atomic<bool>               mHasRule;  // read by schedule timer
+    std::atomic<bool>               mSettingsChanged;
+
+    // Scanners owned by rule terms are invalidated on scanner thread, rule
+    // might be recompiled meanwhile. Set from window thread.
+    std::atomic<bool>               mRuleInvalidated;     // all, e.g. after resume
+    std::atomic<bool>               mRuleDevicesChanged;
+    std::atomic<bool>               mRuleSessionsChanged;
+
+    CompiledSchedule                mSchedule;
+    std::atomic<bool>               mScheduleChanged;
+    LocalTimeCache                  mLocalTime;
+    bool                            mIsInSchedule;  // before debounce, for transition log
+
+    // Schedule timer sleeps until next schedule transition or UTC offset
+    // change, clock and time zone changes wake it up. This is only safety
+    // net.
+    static constexpr auto MaxScheduleSleep = ThreadTimer::Interval(24 * 60 * 60 * 1000);
+
     auto ScannerTimerProc  (const StopToken& stop, const PauseToken& pause) -> bool;
     auto ScheduleTimerProc (const StopToken& stop, const PauseToken& pause) -> bool;
 
+    // User input is recent enough that system won't sleep before next scans.
+    auto IsUserActive (const Settings& settings) -> bool;
+
+    auto GetScanInterval (const Settings& settings) const -> ThreadTimer::Interval;
+    auto IsTriggerActive (const Settings& settings, bool enabled, const Scanner& scanner) const -> bool;
+    auto ReadPowerSource () -> bool;
+    auto IsAllowedOnBattery (const Settings& settings, std::string_view trigger) const -> bool;
+
+    // Scanner order is recomputed after this many ticks.
+    static constexpr auto ScanOrderTicks = 30;
+
+    auto GetTriggerConfig   (const Settings& settings, const Scanner& scanner) const -> TriggerConfig;
+    auto GetTriggerInterval (const Settings& settings, const TriggerConfig& config) const -> ScanClock::duration;
+    auto UpdateScanOrder    (const Settings& settings) -> void;
+    auto GetScanOrderText   () const -> std::string;
+
+    // Source of scanner reported change, scanned on next tick no matter
+    // its interval. Called from tracker threads.
+    auto OnSourceChange (Scanner& scanner) -> void;
+    auto MarkAllChanged () -> void;
+
+    auto GetScanners    () -> std::vector<Scanner*>;
+    auto IsTriggerUsed  (bool enabled, const Scanner& scanner) const -> bool;
+    auto CreateRuleTerm (const RulePredicate& predicate, SettingsPtr settings, RuleTerm& term, std::wstring& error) -> bool;
+    auto UpdateRule     (SettingsPtr settings) -> bool;
+    auto CompileRule    (SettingsPtr settings) -> bool;
+    auto UpdateTrackers (SettingsPtr settings) -> void;
+    auto OptimizeRule   () -> void;
+    auto InvalidateRule () -> void;
+    auto EvaluateRule   (SettingsPtr settings, const StopToken& stop, const PauseToken& pause, ScanClock::time_point now, ScanClock::time_point& next) -> bool;
+
 public:
     AutoMode (CaffeineAppSO app);
 
     auto Start () -> bool override;
     auto Stop  () -> bool override;
 
+    // System resumed, scanners should drop cached capabilities and retry
+    // failed subsystems.
+    auto InvalidateScanners () -> void;
+
+    // Device node added or removed, only device dependent scanners are
+    // invalidated and rescanned.
+    auto OnDeviceChange () -> void;
+
+    // Session logon, logoff, connect or disconnect in any session.
+    auto OnSessionChange () -> void;
+
+    // System time or time zone changed, local time mapping is rebuilt.
+    auto OnTimeChange () -> void;
+
+    // AC/battery switch.
+    auto OnPowerSourceChange () -> void;
+
+    // Settings were edited, rule is recompiled and triggers rescanned on
+    // next tick.
+    auto OnSettingsChange () -> void
+    {
+        mSettingsChanged = true;
+        mScheduleChanged = true;
+        MarkAllChanged();
+        mScannerTimer.Wake();
+        mScheduleTimer.Wake();
+    }
+
+    auto SetIdleTimeSource (std::unique_ptr<IdleTimeSource> source) -> void
+    {
+        mIdleSource = std::move(source);
+    }
+
     auto GetIcon (CaffeineState state) const -> const HICON override;
     auto GetTip  (CaffeineState state) const -> const std::wstring& override;
 
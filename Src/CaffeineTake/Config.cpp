@@ -27,18 +27,29 @@
 #   pragma comment(lib, "ClassicNotifyIcon.lib")
 #endif
 
-#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION)
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE)
+#   pragma comment(lib, "PowrProf.lib")
+#endif
+
+#if defined(FEATURE_CAFFEINETAKE_LOCKSCREEN_DETECTION) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
 #   pragma comment(lib, "Wtsapi32.lib")
 #endif
 
 #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
 #   pragma comment(lib, "SetupAPI.lib")
+#   pragma comment(lib, "Cfgmgr32.lib")
 #endif
 
 #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
 #   pragma comment(lib, "Bthprops.lib")
 #endif
 
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP)
+#   pragma comment(lib, "Iphlpapi.lib")
+#endif
+
 #if defined(FEATURE_CAFFEINETAKE_NOTIFICATION_SOUND)
 #   pragma comment(lib, "Winmm.lib")
 #endif
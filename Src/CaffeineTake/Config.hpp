@@ -32,6 +32,15 @@
 #define ENABLE_FEATURE_AUTO_MODE_TRIGGER_USB
 #define ENABLE_FEATURE_AUTO_MODE_TRIGGER_BLUETOOTH
 #define ENABLE_FEATURE_AUTO_MODE_TRIGGER_SCHEDULE
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_FULLSCREEN
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_NETWORK
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_DISK
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_CPU
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_TCP
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_DIRECTORY
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_REMOTE_SESSION
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_JOB
+#define ENABLE_FEATURE_AUTO_MODE_TRIGGER_PIDFILE
 #define ENABLE_FEATURE_SETTINGS
 #define ENABLE_FEATURE_IMMERSIVE_CONTEXT_MENU
 #define ENABLE_FEATURE_JUMPLISTS
@@ -57,6 +66,15 @@ enum class Feature
     AutoMode_TriggerUsb,
     AutoMode_TriggerBluetooth,
     AutoMode_TriggerSchedule,
+    AutoMode_TriggerFullscreen,
+    AutoMode_TriggerNetwork,
+    AutoMode_TriggerDisk,
+    AutoMode_TriggerCpu,
+    AutoMode_TriggerTcp,
+    AutoMode_TriggerDirectory,
+    AutoMode_TriggerRemoteSession,
+    AutoMode_TriggerJob,
+    AutoMode_TriggerPidFile,
     Settings,
     ImmersiveContextMenu,
     JumpLists,
@@ -119,6 +137,15 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB
 #   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH
 #   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE
 #   define FEATURE_CAFFEINETAKE_SETTINGS
 #   define FEATURE_CAFFEINETAKE_IMMERSIVE_CONTEXT_MENU
 #   define FEATURE_CAFFEINETAKE_JUMPLISTS
@@ -145,6 +172,15 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB
 #   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH
 #   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB
+#   define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE
 #   define FEATURE_CAFFEINETAKE_SETTINGS
 #   define FEATURE_CAFFEINETAKE_IMMERSIVE_CONTEXT_MENU
 #   define FEATURE_CAFFEINETAKE_JUMPLISTS
@@ -193,6 +229,42 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_SCHEDULE)
 #       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE
 #   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_FULLSCREEN)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_NETWORK)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_DISK)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_CPU)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_TCP)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_DIRECTORY)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_JOB)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB
+#   endif
+
+#   if defined (ENABLE_FEATURE_AUTO_MODE_TRIGGER_PIDFILE)
+#       define FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE
+#   endif
 #endif
 
 // Caffeine Timer Mode.
@@ -264,6 +336,15 @@ constexpr auto FeatureToString    (const Feature f) -> const wchar_t*;
 #undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_USB
 #undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_BLUETOOTH
 #undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_SCHEDULE
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_FULLSCREEN
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_NETWORK
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_DISK
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_CPU
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_TCP
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_DIRECTORY
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_REMOTE_SESSION
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_JOB
+#undef ENABLE_FEATURE_AUTO_MODE_TRIGGER_PIDFILE
 #undef ENABLE_FEATURE_SETTINGS
 #undef ENABLE_FEATURE_IMMERSIVE_CONTEXT_MENU
 #undef ENABLE_FEATURE_JUMPLISTS
@@ -329,6 +410,60 @@ constexpr auto IsFeatureAvailable(const Feature f) -> bool
         return true;
 #else
         return false;
+#endif
+    case Feature::AutoMode_TriggerFullscreen:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerNetwork:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerDisk:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerCpu:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerTcp:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerDirectory:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerRemoteSession:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerJob:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB)
+        return true;
+#else
+        return false;
+#endif
+    case Feature::AutoMode_TriggerPidFile:
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE)
+        return true;
+#else
+        return false;
 #endif
     case Feature::Settings:
 #if defined(FEATURE_CAFFEINETAKE_SETTINGS)
@@ -407,6 +542,15 @@ constexpr auto FeatureToString  (const Feature f) -> const wchar_t*
     case Feature::AutoMode_TriggerUsb:          return L"AutoMode_TriggerUsb";
     case Feature::AutoMode_TriggerBluetooth:    return L"AutoMode_TriggerBluetooth";
     case Feature::AutoMode_TriggerSchedule:     return L"AutoMode_TriggerSchedule";
+    case Feature::AutoMode_TriggerFullscreen:   return L"AutoMode_TriggerFullscreen";
+    case Feature::AutoMode_TriggerNetwork:      return L"AutoMode_TriggerNetwork";
+    case Feature::AutoMode_TriggerDisk:         return L"AutoMode_TriggerDisk";
+    case Feature::AutoMode_TriggerCpu:          return L"AutoMode_TriggerCpu";
+    case Feature::AutoMode_TriggerTcp:          return L"AutoMode_TriggerTcp";
+    case Feature::AutoMode_TriggerDirectory:    return L"AutoMode_TriggerDirectory";
+    case Feature::AutoMode_TriggerRemoteSession: return L"AutoMode_TriggerRemoteSession";
+    case Feature::AutoMode_TriggerJob:           return L"AutoMode_TriggerJob";
+    case Feature::AutoMode_TriggerPidFile:       return L"AutoMode_TriggerPidFile";
     case Feature::Settings:                     return L"Settings";
     case Feature::ImmersiveContextMenu:         return L"ImmersiveContextMenu";
     case Feature::JumpLists:                    return L"JumpLists";
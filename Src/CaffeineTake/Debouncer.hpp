@@ -0,0 +1,122 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+namespace CaffeineTake {
+
+// Delays changes of boolean state. New state must hold for on/off delay
+// before it's accepted and accepted state is kept at least for minimum
+// hold time, so short flips of input don't reach output.
+class Debouncer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Delays
+    {
+        Clock::duration OnDelay  = Clock::duration::zero();
+        Clock::duration OffDelay = Clock::duration::zero();
+        Clock::duration MinHold  = Clock::duration::zero();
+    };
+
+private:
+    bool               mState        = false;
+    bool               mIsPending    = false;  // input differs from state
+    Clock::time_point  mPendingSince = Clock::time_point();
+    Clock::time_point  mStateSince   = Clock::time_point();
+    unsigned long long mChanges      = 0;
+    unsigned long long mSuppressed   = 0;      // flips that didn't reach output
+
+public:
+    // Returns debounced state.
+    auto Update (bool input, Clock::time_point time, const Delays& delays) -> bool
+    {
+        if (input == mState)
+        {
+            if (mIsPending)
+            {
+                mIsPending   = false;
+                mSuppressed += 1;
+            }
+
+            return mState;
+        }
+
+        if (!mIsPending)
+        {
+            mIsPending    = true;
+            mPendingSince = time;
+        }
+
+        if (time >= GetChangeTime(delays))
+        {
+            mState      = input;
+            mStateSince = time;
+            mIsPending  = false;
+            mChanges   += 1;
+        }
+
+        return mState;
+    }
+
+    // Time at which pending state is accepted if input stays the same,
+    // max if nothing is pending.
+    auto GetChangeTime (const Delays& delays) const -> Clock::time_point
+    {
+        if (!mIsPending)
+        {
+            return Clock::time_point::max();
+        }
+
+        const auto delay = mState ? delays.OffDelay : delays.OnDelay;
+        return std::max(mPendingSince + delay, mStateSince + delays.MinHold);
+    }
+
+    auto GetState () const -> bool
+    {
+        return mState;
+    }
+
+    auto GetChanges () const -> unsigned long long
+    {
+        return mChanges;
+    }
+
+    auto GetSuppressed () const -> unsigned long long
+    {
+        return mSuppressed;
+    }
+
+    auto Reset () -> void
+    {
+        mState      = false;
+        mIsPending  = false;
+        mStateSince = Clock::time_point();
+        mChanges    = 0;
+        mSuppressed = 0;
+    }
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,273 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "DirectoryWatcher.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+
+namespace CaffeineTake {
+
+namespace {
+    // Contents are not parsed, any completion means activity. Overflow
+    // completes with zero bytes, which is fine too.
+    constexpr auto NOTIFY_BUFFER_SIZE = size_t{4096};
+
+    constexpr auto NOTIFY_FILTER =
+        FILE_NOTIFY_CHANGE_FILE_NAME |
+        FILE_NOTIFY_CHANGE_DIR_NAME  |
+        FILE_NOTIFY_CHANGE_SIZE      |
+        FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+    // One slot is used by stop event.
+    constexpr auto MAX_DIRECTORIES = size_t{MAXIMUM_WAIT_OBJECTS - 1};
+}
+
+auto WindowsDirectoryChangeSource::CloseAll () -> void
+{
+    for (auto& watch : mWatches)
+    {
+        if (watch.Directory != INVALID_HANDLE_VALUE)
+        {
+            CancelIoEx(watch.Directory, &watch.Overlapped);
+
+            // Buffer must stay valid until cancelled read completes.
+            auto transferred = DWORD{0};
+            GetOverlappedResult(watch.Directory, &watch.Overlapped, &transferred, TRUE);
+
+            CloseHandle(watch.Directory);
+        }
+
+        if (watch.Overlapped.hEvent)
+        {
+            CloseHandle(watch.Overlapped.hEvent);
+        }
+    }
+
+    mWatches.clear();
+}
+
+auto WindowsDirectoryChangeSource::MarkMissing (const std::wstring& path) -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMissingMutex);
+    mMissing.push_back(path);
+}
+
+auto WindowsDirectoryChangeSource::Start (const std::vector<std::wstring>& directories, ChangeFn onChange) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    return false;
+#else
+    Stop();
+
+    if (directories.size() > MAX_DIRECTORIES)
+    {
+        LOG_WARNING("Too many watched directories, only first {} are watched", MAX_DIRECTORIES);
+    }
+
+    // Kept even if nothing could be opened, so Retry() can start later.
+    mDirectories.assign(directories.begin(), directories.begin() + std::min(directories.size(), MAX_DIRECTORIES));
+    mOnChange = onChange;
+
+    for (const auto& path : mDirectories)
+    {
+        auto watch = Watch();
+        watch.Path      = path;
+        watch.Directory = CreateFileW(
+            path.c_str(),
+            FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+            NULL
+        );
+
+        if (watch.Directory == INVALID_HANDLE_VALUE)
+        {
+            LOG_WARNING(L"Can't watch directory '{}', error {}", path, GetLastError());
+            MarkMissing(path);
+            continue;
+        }
+
+        watch.Overlapped.hEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        watch.Buffer.resize(NOTIFY_BUFFER_SIZE);
+
+        mWatches.push_back(std::move(watch));
+    }
+
+    if (mWatches.empty())
+    {
+        return false;
+    }
+
+    mStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    mIsRunning = true;
+    mThread    = std::thread(&WindowsDirectoryChangeSource::ThreadProc, this);
+
+    LOG_DEBUG("Watching {} directories", mWatches.size());
+
+    return true;
+#endif
+}
+
+auto WindowsDirectoryChangeSource::Stop () -> void
+{
+    mIsRunning = false;
+
+    if (mThread.joinable())
+    {
+        SetEvent(mStopEvent);
+        mThread.join();
+    }
+
+    CloseAll();
+
+    if (mStopEvent)
+    {
+        CloseHandle(mStopEvent);
+        mStopEvent = NULL;
+    }
+
+    mOnChange = nullptr;
+    mDirectories.clear();
+
+    auto lockGuard = std::lock_guard<std::mutex>(mMissingMutex);
+    mMissing.clear();
+}
+
+auto WindowsDirectoryChangeSource::Retry () -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    return false;
+#else
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMissingMutex);
+
+        const auto isBack = std::any_of(mMissing.begin(), mMissing.end(), [](const std::wstring& path) {
+            const auto attributes = GetFileAttributesW(path.c_str());
+            return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+        });
+
+        if (!isBack)
+        {
+            return false;
+        }
+    }
+
+    // Restarting is simpler than adding handles to running thread, the
+    // short gap only delays activity until next write.
+    const auto directories = mDirectories;
+    const auto onChange    = mOnChange;
+
+    LOG_INFO("Missing watched directory is available again, reopening watches");
+
+    Start(directories, onChange);
+
+    return true;
+#endif
+}
+
+auto WindowsDirectoryChangeSource::ThreadProc () -> void
+{
+    auto handles = std::vector<HANDLE>();
+    handles.push_back(mStopEvent);
+
+    const auto issueRead = [](Watch& watch) {
+        return ReadDirectoryChangesW(
+            watch.Directory,
+            watch.Buffer.data(),
+            static_cast<DWORD>(watch.Buffer.size()),
+            TRUE,
+            NOTIFY_FILTER,
+            NULL,
+            &watch.Overlapped,
+            NULL
+        );
+    };
+
+    for (auto& watch : mWatches)
+    {
+        if (!issueRead(watch))
+        {
+            LOG_WARNING(L"ReadDirectoryChangesW() failed for '{}', error {}", watch.Path, GetLastError());
+            MarkMissing(watch.Path);
+            continue;
+        }
+
+        handles.push_back(watch.Overlapped.hEvent);
+    }
+
+    while (true)
+    {
+        // Only stop event left.
+        if (handles.size() == 1)
+        {
+            LOG_WARNING("No watched directory left, directory monitoring stopped");
+            mIsRunning = false;
+            break;
+        }
+
+        const auto result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+        if (result == WAIT_OBJECT_0 || result == WAIT_FAILED)
+        {
+            break;
+        }
+
+        const auto index = result - WAIT_OBJECT_0;
+        if (index >= handles.size())
+        {
+            continue;
+        }
+
+        auto& watch = *std::find_if(
+            mWatches.begin(), mWatches.end(), [&](const Watch& w) { return w.Overlapped.hEvent == handles[index]; }
+        );
+
+        auto transferred = DWORD{0};
+        if (!GetOverlappedResult(watch.Directory, &watch.Overlapped, &transferred, FALSE))
+        {
+            // Directory deleted or volume removed, stop watching it until
+            // Retry() finds it again.
+            LOG_WARNING(L"Stopped watching '{}', error {}", watch.Path, GetLastError());
+            MarkMissing(watch.Path);
+            handles.erase(handles.begin() + index);
+            continue;
+        }
+
+        if (mOnChange)
+        {
+            mOnChange();
+        }
+
+        if (!issueRead(watch))
+        {
+            LOG_WARNING(L"Stopped watching '{}', error {}", watch.Path, GetLastError());
+            MarkMissing(watch.Path);
+            handles.erase(handles.begin() + index);
+        }
+    }
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,103 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+namespace CaffeineTake {
+
+// Source of file system change events, separated from scanner so it can be
+// replaced. Callback is called from source's thread on any change in
+// watched directories or their subdirectories.
+class DirectoryChangeSource
+{
+public:
+    using ChangeFn = std::function<void ()>;
+
+    virtual ~DirectoryChangeSource() {}
+
+    virtual auto Start (const std::vector<std::wstring>& directories, ChangeFn onChange) -> bool = 0;
+    virtual auto Stop  () -> void = 0;
+
+    // False after Stop() or when no watched directory is left, e.g. all
+    // were deleted.
+    virtual auto IsRunning () const -> bool = 0;
+
+    // Reopens watches if any directory missing at start or deleted later
+    // exists again. Returns true if watches were reopened.
+    virtual auto Retry () -> bool = 0;
+};
+
+// ReadDirectoryChangesW on each root with subtree watching, so large trees
+// need single handle per root. All roots are serviced by one thread that
+// sleeps until something changes, nothing is polled. Missing roots are
+// only checked when Retry() is called.
+class WindowsDirectoryChangeSource : public DirectoryChangeSource
+{
+    struct Watch
+    {
+        std::wstring      Path       = L"";
+        HANDLE            Directory  = INVALID_HANDLE_VALUE;
+        OVERLAPPED        Overlapped = OVERLAPPED();
+        std::vector<BYTE> Buffer     = std::vector<BYTE>();
+    };
+
+    std::thread               mThread;
+    HANDLE                    mStopEvent   = NULL;
+    std::vector<Watch>        mWatches     = std::vector<Watch>();
+    std::vector<std::wstring> mDirectories = std::vector<std::wstring>();  // all requested, watched or not
+    std::vector<std::wstring> mMissing     = std::vector<std::wstring>();  // guarded by mMissingMutex
+    std::mutex                mMissingMutex;
+    ChangeFn                  mOnChange    = nullptr;
+    std::atomic<bool>         mIsRunning   = false;
+
+    auto MarkMissing (const std::wstring& path) -> void;
+
+    auto ThreadProc () -> void;
+    auto CloseAll   () -> void;
+
+public:
+    ~WindowsDirectoryChangeSource ()
+    {
+        Stop();
+    }
+
+    auto Start (const std::vector<std::wstring>& directories, ChangeFn onChange) -> bool override;
+    auto Stop  () -> void override;
+    auto Retry () -> bool override;
+
+    auto IsRunning () const -> bool override
+    {
+        return mIsRunning;
+    }
+};
+
+} // namespace CaffeineTake
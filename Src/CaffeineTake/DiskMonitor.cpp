@@ -0,0 +1,256 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "DiskMonitor.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cwctype>
+#include <format>
+
+#include <winioctl.h>
+
+namespace CaffeineTake {
+
+namespace {
+    constexpr auto MAX_PHYSICAL_DRIVES = DWORD{32};
+
+    auto OpenDevice (const std::wstring& path) -> HANDLE
+    {
+        // No access rights needed for querying, works without elevation.
+        return CreateFileW(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    }
+
+    auto QueryPerformance (HANDLE handle, DISK_PERFORMANCE& perf) -> bool
+    {
+        auto returned = DWORD{0};
+        return DeviceIoControl(handle, IOCTL_DISK_PERFORMANCE, NULL, 0, &perf, sizeof(perf), &returned, NULL);
+    }
+
+    // "PhysicalDrive2" or "D:" to disk number.
+    auto ParseDiskName (const std::wstring& name, DWORD& number) -> bool
+    {
+        constexpr auto prefix = std::wstring_view(L"PhysicalDrive");
+        if (name.size() > prefix.size() && _wcsnicmp(name.c_str(), prefix.data(), prefix.size()) == 0)
+        {
+            number = 0;
+            for (auto i = prefix.size(); i < name.size(); ++i)
+            {
+                if (!std::iswdigit(name[i]))
+                {
+                    return false;
+                }
+
+                number = number * 10 + (name[i] - L'0');
+            }
+
+            return true;
+        }
+
+        if (name.size() == 2 && std::iswalpha(name[0]) && name[1] == L':')
+        {
+            const auto volume = OpenDevice(std::format(L"\\\\.\\{}", name));
+            if (volume == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            auto deviceNumber = STORAGE_DEVICE_NUMBER{};
+            auto returned     = DWORD{0};
+            const auto result = DeviceIoControl(
+                volume, IOCTL_STORAGE_GET_DEVICE_NUMBER, NULL, 0, &deviceNumber, sizeof(deviceNumber), &returned, NULL
+            );
+
+            CloseHandle(volume);
+
+            if (!result || deviceNumber.DeviceType != FILE_DEVICE_DISK)
+            {
+                return false;
+            }
+
+            number = deviceNumber.DeviceNumber;
+            return true;
+        }
+
+        return false;
+    }
+}
+
+auto DiskMonitor::CloseAll () -> void
+{
+    for (auto& disk : mDisks)
+    {
+        if (disk.Handle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(disk.Handle);
+        }
+    }
+
+    mDisks.clear();
+}
+
+auto DiskMonitor::Resolve () -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK)
+    return false;
+#else
+    auto numbers = std::vector<DWORD>();
+    if (mNames.empty())
+    {
+        for (auto n = DWORD{0}; n < MAX_PHYSICAL_DRIVES; ++n)
+        {
+            numbers.push_back(n);
+        }
+    }
+    else
+    {
+        for (const auto& name : mNames)
+        {
+            auto number = DWORD{0};
+            if (ParseDiskName(name, number))
+            {
+                numbers.push_back(number);
+            }
+            else
+            {
+                LOG_DEBUG(L"Disk '{}' not found", name);
+            }
+        }
+    }
+
+    std::sort(numbers.begin(), numbers.end());
+    numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+
+    // Keep handles and counters of disks that are still selected.
+    auto disks = std::vector<Disk>();
+    for (const auto number : numbers)
+    {
+        const auto it = std::find_if(mDisks.begin(), mDisks.end(), [&](const Disk& d) { return d.Number == number; });
+        if (it != mDisks.end())
+        {
+            disks.push_back(*it);
+            it->Handle = INVALID_HANDLE_VALUE;
+            continue;
+        }
+
+        const auto handle = OpenDevice(std::format(L"\\\\.\\PhysicalDrive{}", number));
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            continue;
+        }
+
+        // Baseline, so already transferred bytes are not counted.
+        auto perf = DISK_PERFORMANCE{};
+        if (!QueryPerformance(handle, perf))
+        {
+            CloseHandle(handle);
+            continue;
+        }
+
+        disks.push_back(
+            Disk{
+                handle,
+                number,
+                static_cast<unsigned long long>(perf.BytesRead.QuadPart + perf.BytesWritten.QuadPart),
+                perf.ReadCount + perf.WriteCount
+            }
+        );
+    }
+
+    if (disks.size() != mDisks.size())
+    {
+        LOG_DEBUG("Monitoring {} disks", disks.size());
+    }
+
+    CloseAll();
+
+    mDisks       = std::move(disks);
+    mIsResolved  = true;
+    mResolveTime = Clock::now();
+
+    return true;
+#endif
+}
+
+auto DiskMonitor::SetDisks (const std::vector<std::wstring>& names) -> void
+{
+    if (mNames != names)
+    {
+        mNames = names;
+        CloseAll();
+        mIsResolved = false;
+    }
+}
+
+auto DiskMonitor::Sample (unsigned long long& totalBytes, unsigned long long& totalOps) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK)
+    return false;
+#else
+    if (mInvalidated.exchange(false))
+    {
+        mIsResolved = false;
+    }
+
+    if (!mIsResolved || Clock::now() - mResolveTime > std::chrono::minutes(1))
+    {
+        if (!Resolve())
+        {
+            return false;
+        }
+    }
+
+    for (auto& disk : mDisks)
+    {
+        auto perf = DISK_PERFORMANCE{};
+        if (!QueryPerformance(disk.Handle, perf))
+        {
+            // Disk removed, resolve on next sample.
+            mIsResolved = false;
+            continue;
+        }
+
+        const auto bytes = static_cast<unsigned long long>(perf.BytesRead.QuadPart + perf.BytesWritten.QuadPart);
+        const auto ops   = static_cast<DWORD>(perf.ReadCount + perf.WriteCount);
+
+        if (bytes >= disk.LastBytes)
+        {
+            mTotalBytes += bytes - disk.LastBytes;
+        }
+
+        // Operation counters are 32-bit, unsigned difference handles wrap.
+        mTotalOps += static_cast<DWORD>(ops - disk.LastOps);
+
+        disk.LastBytes = bytes;
+        disk.LastOps   = ops;
+    }
+
+    totalBytes = mTotalBytes;
+    totalOps   = mTotalOps;
+
+    return true;
+#endif
+}
+
+} // namespace CaffeineTake
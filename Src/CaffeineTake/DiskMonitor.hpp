@@ -0,0 +1,86 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+namespace CaffeineTake {
+
+// Reads I/O counters of physical disks. Disk handles are opened once and
+// kept, every sample is single IOCTL_DISK_PERFORMANCE call per disk into
+// fixed size structure.
+class DiskMonitor
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Disk
+    {
+        HANDLE             Handle     = INVALID_HANDLE_VALUE;
+        DWORD              Number     = 0;
+        unsigned long long LastBytes  = 0;
+        DWORD              LastOps    = 0;
+    };
+
+    std::vector<Disk>         mDisks       = std::vector<Disk>();
+    std::vector<std::wstring> mNames       = std::vector<std::wstring>();  // empty means all disks
+    unsigned long long        mTotalBytes  = 0;
+    unsigned long long        mTotalOps    = 0;
+    bool                      mIsResolved  = false;
+    Clock::time_point         mResolveTime = Clock::time_point();
+    std::atomic<bool>         mInvalidated = false;  // set from window thread, handled on next sample
+
+    auto Resolve  () -> bool;
+    auto CloseAll () -> void;
+
+public:
+    ~DiskMonitor ()
+    {
+        CloseAll();
+    }
+
+    // PhysicalDriveN or drive letter ("D:"), re-resolves on change.
+    auto SetDisks (const std::vector<std::wstring>& names) -> void;
+
+    // Disks might be added or removed.
+    auto Invalidate () -> void
+    {
+        mInvalidated = true;
+    }
+
+    // Total bytes and operations (reads + writes) of selected disks since
+    // monitor was created.
+    auto Sample (unsigned long long& totalBytes, unsigned long long& totalOps) -> bool;
+
+    auto GetDiskCount () const -> size_t
+    {
+        return mDisks.size();
+    }
+};
+
+} // namespace CaffeineTake
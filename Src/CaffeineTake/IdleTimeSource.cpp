@@ -0,0 +1,122 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "IdleTimeSource.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE)
+#   include <powrprof.h>
+#endif
+
+namespace CaffeineTake {
+
+namespace {
+    // Shorter non-zero timeout, zero means never.
+    auto MinTimeout (IdleTimeSource::Duration a, IdleTimeSource::Duration b) -> IdleTimeSource::Duration
+    {
+        if (a == IdleTimeSource::Duration::zero()) return b;
+        if (b == IdleTimeSource::Duration::zero()) return a;
+
+        return std::min(a, b);
+    }
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE)
+    // Value of power setting in active scheme for current power source, in seconds.
+    auto ReadPowerSetting (const GUID& subgroup, const GUID& setting, bool isOnAc) -> DWORD
+    {
+        auto scheme = static_cast<GUID*>(nullptr);
+        if (PowerGetActiveScheme(NULL, &scheme) != ERROR_SUCCESS)
+        {
+            return 0;
+        }
+
+        auto value  = DWORD{0};
+        auto result = isOnAc
+            ? PowerReadACValueIndex(NULL, scheme, &subgroup, &setting, &value)
+            : PowerReadDCValueIndex(NULL, scheme, &subgroup, &setting, &value);
+
+        LocalFree(scheme);
+
+        return result == ERROR_SUCCESS ? value : 0;
+    }
+#endif
+}
+
+#pragma region "WindowsIdleTimeSource"
+
+auto WindowsIdleTimeSource::ReadTimeouts () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE)
+    auto status = SYSTEM_POWER_STATUS{};
+    const auto isOnAc = !GetSystemPowerStatus(&status) || status.ACLineStatus != 0;
+
+    const auto sleep   = ReadPowerSetting(GUID_SLEEP_SUBGROUP, GUID_STANDBY_TIMEOUT, isOnAc);
+    const auto display = ReadPowerSetting(GUID_VIDEO_SUBGROUP, GUID_VIDEO_POWERDOWN_TIMEOUT, isOnAc);
+
+    mSleepTimeout   = std::chrono::seconds(sleep);
+    mDisplayTimeout = std::chrono::seconds(display);
+    mReadTime       = Clock::now();
+    mIsValid        = true;
+
+    LOG_DEBUG("Idle timeouts on {}: sleep {} s, display {} s", isOnAc ? "AC" : "battery", sleep, display);
+#endif
+}
+
+auto WindowsIdleTimeSource::GetIdleTime () -> Duration
+{
+    auto info = LASTINPUTINFO{
+        .cbSize = sizeof(LASTINPUTINFO)
+    };
+
+    if (!GetLastInputInfo(&info))
+    {
+        return Duration::zero();
+    }
+
+    // Both are 32-bit tick counts, unsigned difference handles wrap.
+    return Duration(static_cast<DWORD>(GetTickCount() - info.dwTime));
+}
+
+auto WindowsIdleTimeSource::GetIdleTimeout (bool includeDisplay) -> Duration
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+    if (!mIsValid || Clock::now() - mReadTime > RefreshInterval)
+    {
+        ReadTimeouts();
+    }
+
+    return includeDisplay ? MinTimeout(mSleepTimeout, mDisplayTimeout) : mSleepTimeout;
+}
+
+auto WindowsIdleTimeSource::Invalidate () -> void
+{
+    mIsValid = false;
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
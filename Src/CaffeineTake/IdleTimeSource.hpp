@@ -0,0 +1,75 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+namespace CaffeineTake {
+
+// User input idle time and system idle timeouts, separated from AutoMode.
+class IdleTimeSource
+{
+public:
+    using Duration = std::chrono::milliseconds;
+
+    virtual ~IdleTimeSource() {}
+
+    // Time since last keyboard or mouse input.
+    virtual auto GetIdleTime () -> Duration = 0;
+
+    // Idle time after which system sleeps, or display turns off if
+    // includeDisplay is set, whichever comes first. Zero means never.
+    virtual auto GetIdleTimeout (bool includeDisplay) -> Duration = 0;
+
+    // Power settings might have changed.
+    virtual auto Invalidate () -> void {}
+};
+
+// GetLastInputInfo and timeouts of active power scheme. Timeouts are
+// cached, re-read when invalidated or every few minutes.
+class WindowsIdleTimeSource : public IdleTimeSource
+{
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr auto RefreshInterval = std::chrono::minutes(5);
+
+    std::mutex        mMutex;
+    Duration          mSleepTimeout   = Duration::zero();
+    Duration          mDisplayTimeout = Duration::zero();
+    Clock::time_point mReadTime       = Clock::time_point();
+    std::atomic<bool> mIsValid        = false;
+
+    auto ReadTimeouts () -> void;
+
+public:
+    auto GetIdleTime    () -> Duration override;
+    auto GetIdleTimeout (bool includeDisplay) -> Duration override;
+    auto Invalidate     () -> void override;
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,91 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "JobSource.hpp"
+
+#include "Logger.hpp"
+
+namespace CaffeineTake {
+
+#pragma region "WindowsJobSource"
+
+auto WindowsJobSource::CloseAll () -> void
+{
+    for (const auto& [name, job] : mJobs)
+    {
+        if (job.Handle)
+        {
+            CloseHandle(job.Handle);
+        }
+    }
+
+    mJobs.clear();
+}
+
+auto WindowsJobSource::Query (const std::wstring& name, JobAccounting& accounting) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB)
+    return false;
+#else
+    auto& job = mJobs[name];
+    if (!job.Handle)
+    {
+        const auto now = Clock::now();
+        if (job.OpenTime != Clock::time_point() && now - job.OpenTime < RetryInterval)
+        {
+            return false;
+        }
+
+        job.OpenTime = now;
+        job.Handle   = OpenJobObjectW(JOB_OBJECT_QUERY, FALSE, name.c_str());
+        if (!job.Handle)
+        {
+            return false;
+        }
+
+        LOG_DEBUG(L"Opened job '{}'", name);
+    }
+
+    auto info = JOBOBJECT_BASIC_ACCOUNTING_INFORMATION{};
+    if (!QueryInformationJobObject(job.Handle, JobObjectBasicAccountingInformation, &info, sizeof(info), NULL))
+    {
+        CloseHandle(job.Handle);
+        job.Handle = NULL;
+        return false;
+    }
+
+    accounting.ActiveProcesses = info.ActiveProcesses;
+    accounting.CpuTime         = static_cast<unsigned long long>(info.TotalUserTime.QuadPart + info.TotalKernelTime.QuadPart);
+
+    return true;
+#endif
+}
+
+auto WindowsJobSource::Invalidate () -> void
+{
+    CloseAll();
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
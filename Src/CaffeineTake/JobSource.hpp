@@ -0,0 +1,82 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+namespace CaffeineTake {
+
+struct JobAccounting
+{
+    DWORD              ActiveProcesses = 0;
+    unsigned long long CpuTime         = 0;   // user + kernel, in 100ns units
+};
+
+// Access to job object accounting, separated from scanner.
+class JobSource
+{
+public:
+    virtual ~JobSource() {}
+
+    // Returns false if job doesn't exist.
+    virtual auto Query (const std::wstring& name, JobAccounting& accounting) -> bool = 0;
+
+    // Drop cached state, jobs might have been recreated.
+    virtual auto Invalidate () -> void = 0;
+};
+
+// Named job objects, handles are opened on first query and kept, so every
+// query is single QueryInformationJobObject call. Missing jobs are retried
+// only every few seconds.
+class WindowsJobSource : public JobSource
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Job
+    {
+        HANDLE            Handle   = NULL;
+        Clock::time_point OpenTime = Clock::time_point();
+    };
+
+    static constexpr auto RetryInterval = std::chrono::seconds(10);
+
+    std::unordered_map<std::wstring, Job> mJobs = std::unordered_map<std::wstring, Job>();
+
+    auto CloseAll () -> void;
+
+public:
+    ~WindowsJobSource ()
+    {
+        CloseAll();
+    }
+
+    auto Query      (const std::wstring& name, JobAccounting& accounting) -> bool override;
+    auto Invalidate () -> void override;
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,170 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "LocalTimeCache.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+namespace CaffeineTake {
+
+namespace {
+    // Offsets are sampled with this step, then transition is searched
+    // between samples. Time zones don't change offset twice in an hour.
+    constexpr auto SampleStep = std::chrono::hours(1);
+
+    // Seconds between 1601-01-01 (FILETIME) and 1970-01-01.
+    constexpr auto FileTimeEpoch = 11644473600ll;
+
+    auto ToFileTimeTicks (std::chrono::sys_seconds time) -> long long
+    {
+        return (time.time_since_epoch().count() + FileTimeEpoch) * 10000000ll;
+    }
+
+    // UTC offset of local time using given time zone settings.
+    auto GetUtcOffset (const DYNAMIC_TIME_ZONE_INFORMATION& tz, std::chrono::sys_seconds time) -> std::chrono::seconds
+    {
+        const auto ticks = ToFileTimeTicks(time);
+
+        auto utcFileTime = FILETIME();
+        utcFileTime.dwLowDateTime  = static_cast<DWORD>(ticks & 0xFFFFFFFF);
+        utcFileTime.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+
+        auto utcTime       = SYSTEMTIME();
+        auto localTime     = SYSTEMTIME();
+        auto localFileTime = FILETIME();
+
+        if (!FileTimeToSystemTime(&utcFileTime, &utcTime)
+         || !SystemTimeToTzSpecificLocalTimeEx(&tz, &utcTime, &localTime)
+         || !SystemTimeToFileTime(&localTime, &localFileTime))
+        {
+            return std::chrono::seconds(0);
+        }
+
+        const auto localTicks = static_cast<long long>(
+            (static_cast<unsigned long long>(localFileTime.dwHighDateTime) << 32) | localFileTime.dwLowDateTime
+        );
+
+        return std::chrono::seconds((localTicks - ticks) / 10000000ll);
+    }
+}
+
+auto LocalTimeCache::Build (Clock::time_point time) -> void
+{
+    mPeriods.clear();
+    mIsValid = true;
+
+    const auto begin = std::chrono::floor<std::chrono::seconds>(time) - CoverBefore;
+    const auto end   = begin + CoverBefore + CoverAfter;
+
+    auto tz = DYNAMIC_TIME_ZONE_INFORMATION();
+    if (GetDynamicTimeZoneInformation(&tz) == TIME_ZONE_ID_INVALID)
+    {
+        LOG_ERROR("GetDynamicTimeZoneInformation() failed with error: {}", GetLastError());
+        mPeriods.push_back(Period{ begin, end, std::chrono::seconds(0) });
+        return;
+    }
+
+    auto periodBegin = begin;
+    auto offset      = GetUtcOffset(tz, begin);
+
+    for (auto sample = begin + SampleStep; sample <= end; sample += SampleStep)
+    {
+        const auto sampleOffset = GetUtcOffset(tz, sample);
+        if (sampleOffset == offset)
+        {
+            continue;
+        }
+
+        // Binary search for first second with new offset.
+        auto low  = sample - SampleStep;
+        auto high = sample;
+        while (high - low > std::chrono::seconds(1))
+        {
+            const auto middle = low + (high - low) / 2;
+            if (GetUtcOffset(tz, middle) == offset)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        mPeriods.push_back(Period{ periodBegin, high, offset });
+        periodBegin = high;
+        offset      = sampleOffset;
+    }
+
+    mPeriods.push_back(Period{ periodBegin, end, offset });
+
+    LOG_DEBUG(
+        "Built local time table, {} offset changes, current offset {} s",
+        mPeriods.size() - 1, Find(time).Offset.count()
+    );
+}
+
+auto LocalTimeCache::Find (Clock::time_point time) -> const Period&
+{
+    if (!mIsValid || time < mPeriods.front().Begin || time >= mPeriods.back().End)
+    {
+        Build(time);
+    }
+
+    const auto it = std::find_if(
+        mPeriods.begin(), mPeriods.end(), [&](const Period& period) { return time < period.End; }
+    );
+
+    return it != mPeriods.end() ? *it : mPeriods.back();
+}
+
+auto LocalTimeCache::ToLocal (Clock::time_point time) -> LocalTime
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+    const auto& period = Find(time);
+    return LocalTime((time + period.Offset).time_since_epoch());
+}
+
+auto LocalTimeCache::GetNextTransition (Clock::time_point time) -> Clock::time_point
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+    return Find(time).End;
+}
+
+auto LocalTimeCache::Invalidate () -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+    mIsValid = false;
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,68 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace CaffeineTake {
+
+// UTC to local time mapping with UTC offset changes (DST) of few days
+// around current time, so conversion doesn't query time zone on every
+// call. Built from current system time zone settings, invalidated when
+// system time or time zone changes.
+class LocalTimeCache
+{
+public:
+    using Clock     = std::chrono::system_clock;
+    using LocalTime = std::chrono::local_time<Clock::duration>;
+
+private:
+    // Time range with the same UTC offset, [Begin, End).
+    struct Period
+    {
+        Clock::time_point    Begin  = Clock::time_point();
+        Clock::time_point    End    = Clock::time_point();
+        std::chrono::seconds Offset = std::chrono::seconds(0);
+    };
+
+    static constexpr auto CoverBefore = std::chrono::hours(24);
+    static constexpr auto CoverAfter  = std::chrono::hours(8 * 24);
+
+    std::mutex          mMutex;
+    std::vector<Period> mPeriods = std::vector<Period>();
+    bool                mIsValid = false;
+
+    auto Build (Clock::time_point time) -> void;
+    auto Find  (Clock::time_point time) -> const Period&;
+
+public:
+    auto ToLocal (Clock::time_point time) -> LocalTime;
+
+    // Next UTC offset change after time, or end of cached range.
+    auto GetNextTransition (Clock::time_point time) -> Clock::time_point;
+
+    auto Invalidate () -> void;
+};
+
+} // namespace CaffeineTake
@@ -26,8 +26,44 @@
 #include "Logger.hpp"
 #include "Settings.hpp"
 
+#include <algorithm>
+#include <climits>
+#include <cwctype>
+#include <format>
+#include <iterator>
+#include <utility>
+
 namespace CaffeineTake {
 
+namespace {
+    // Index of trigger in list of names from settings, case insensitive,
+    // or size of list if not found.
+    auto FindTrigger (const std::vector<std::wstring>& names, std::string_view trigger) -> size_t
+    {
+        const auto it = std::find_if(
+            names.begin(), names.end(),
+            [&](const std::wstring& name)
+            {
+                return name.size() == trigger.size() && std::equal(
+                    name.begin(), name.end(), trigger.begin(),
+                    [](wchar_t a, char b) { return std::towlower(a) == std::towlower(static_cast<wchar_t>(b)); }
+                );
+            }
+        );
+
+        return static_cast<size_t>(it - names.begin());
+    }
+
+    auto GetDebounceDelays (const Settings& settings) -> Debouncer::Delays
+    {
+        return {
+            std::chrono::milliseconds(settings.Auto.OnDelay),
+            std::chrono::milliseconds(settings.Auto.OffDelay),
+            std::chrono::milliseconds(settings.Auto.MinHoldTime)
+        };
+    }
+}
+
 auto AutoMode::ScannerTimerProc (const StopToken& stop, const PauseToken& pause) -> bool
 {
     const auto settingsPtr = mAppSO.GetSettings();
@@ -36,6 +72,14 @@ auto AutoMode::ScannerTimerProc (const StopToken& stop, const PauseToken& pause)
         return true;
     }
 
+    // Short interval set by previous tick for due trigger or pending
+    // state change must not stay in force while ticks return early.
+    mScannerTimer.ChangeInterval(GetScanInterval(*settingsPtr));
+
+    // Before early returns, rule decides if schedule is used and which
+    // trackers run.
+    const auto hasRule = UpdateRule(settingsPtr);
+
     // If schedule is hit we don't need to scan.
     {
         auto lockGuard = std::lock_guard<std::mutex>(mScanMutex);
@@ -45,32 +89,68 @@ auto AutoMode::ScannerTimerProc (const StopToken& stop, const PauseToken& pause)
         }
     }
 
-    auto scannerResult = false;
-    
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
-    if (!scannerResult && settingsPtr->Auto.TriggerProcess.Enabled)
+    mScanTicks += 1;
+
+    if (mScanTicks % ScanOrderTicks == 0 || mPriorityTriggers != settingsPtr->Auto.PriorityTriggers)
     {
-        scannerResult = mProcessScanner.Run(settingsPtr, stop, pause);
+        UpdateScanOrder(*settingsPtr);
     }
-#endif
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
-    if (!scannerResult && settingsPtr->Auto.TriggerWindow.Enabled)
+
+    // System won't sleep while user is active, keep last result.
+    if (settingsPtr->Auto.IdleAwareScan && IsUserActive(*settingsPtr))
     {
-        scannerResult = mWindowScanner.Run(settingsPtr, stop, pause);
+        mSkippedScans += 1;
+        return true;
     }
-#endif
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
-    if (!scannerResult && settingsPtr->Auto.TriggerUsb.Enabled)
+
+    auto scannerResult = false;
+
+    // Each trigger is scanned on its own interval or when its source
+    // reported change, otherwise last result is used.
+    const auto now = ScanClock::now();
+    auto next      = ScanClock::time_point::max();
+
+    // With rule, triggers below are disabled and rule decides.
+    if (hasRule)
     {
-        scannerResult = mUsbScanner.Run(settingsPtr, stop, pause);
+        InvalidateRule();
+        scannerResult = EvaluateRule(settingsPtr, stop, pause, now, next);
     }
-#endif
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-    if (!scannerResult && settingsPtr->Auto.TriggerBluetooth.Enabled)
+
+    for (const auto scanner : mScanOrder)
+    {
+        const auto config = GetTriggerConfig(*settingsPtr, *scanner);
+        if (!IsTriggerActive(*settingsPtr, config.Enabled, *scanner))
+        {
+            continue;
+        }
+
+        auto&      slot     = mScanSlots.at(scanner);
+        const auto interval = GetTriggerInterval(*settingsPtr, config);
+
+        if (!scannerResult && (slot.Changed.exchange(false) || now >= slot.NextScan))
+        {
+            slot.Result   = scanner->Scan(settingsPtr, stop, pause);
+            slot.NextScan = now + interval;
+        }
+
+        scannerResult = scannerResult || slot.Result;
+
+        // Due but skipped because result is already known.
+        next = std::min(next, slot.NextScan > now ? slot.NextScan : now + interval);
+    }
+
+    // Wake up when pending state change is due.
+    const auto delays = GetDebounceDelays(*settingsPtr);
+    scannerResult = mScannerDebouncer.Update(scannerResult, now, delays);
+    next          = std::min(next, mScannerDebouncer.GetChangeTime(delays));
+
+    if (next != ScanClock::time_point::max())
     {
-        scannerResult = mBluetoothScanner.Run(settingsPtr, stop, pause);
+        mScannerTimer.ChangeInterval(
+            std::chrono::duration_cast<ThreadTimer::Interval>(next - now) + ThreadTimer::Interval(1)
+        );
     }
-#endif
 
     // Only if there is state change.
     if (scannerResult != mScannerResult)
@@ -104,16 +184,63 @@ auto AutoMode::ScheduleTimerProc (const StopToken& stop, const PauseToken& pause
     }
 
     auto scheduleResult = false;
+    auto sleep          = MaxScheduleSleep;
 
 #if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
-    if (settingsPtr->Auto.TriggerSchedule.Enabled)
+    // With rule, schedule is one of its predicates. Invalid rule isn't
+    // used, schedule then works as without rule.
+    if (settingsPtr->Auto.TriggerSchedule.Enabled && !mHasRule)
     {
-        scheduleResult = Schedule::CheckSchedule(
-            settingsPtr->Auto.TriggerSchedule.ScheduleEntries, std::chrono::system_clock::now()
-        );
+        if (mScheduleChanged.exchange(false))
+        {
+            mSchedule = CompiledSchedule::Compile(settingsPtr->Auto.TriggerSchedule.ScheduleEntries);
+            LOG_DEBUG("Compiled schedule to {} ranges", mSchedule.GetRangeCount());
+        }
+
+        const auto now       = std::chrono::system_clock::now();
+        const auto localTime = mLocalTime.ToLocal(now);
+        const auto weekTime  = Schedule::GetWeekTime(localTime);
+        const auto second    = static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::seconds>(weekTime).count());
+
+        scheduleResult = mSchedule.IsActive(second);
+
+        if (scheduleResult && !mIsInSchedule)
+        {
+            const auto fmt = std::format("Time is in schedule, {}", localTime);
+            LOG_INFO("{}", fmt);
+        }
+
+        // Sleep until state changes, rounded up to next full second.
+        const auto transition = mSchedule.GetNextTransition(second);
+        if (transition > 0)
+        {
+            const auto remaining = std::chrono::seconds(second + transition) - weekTime;
+            sleep = std::min(sleep, std::chrono::duration_cast<ThreadTimer::Interval>(remaining) + ThreadTimer::Interval(1));
+
+            LOG_DEBUG("Schedule {}, next change in {} s", scheduleResult ? "active" : "inactive", transition);
+        }
+
+        // Local time of next transition is different after DST change.
+        const auto offsetChange = mLocalTime.GetNextTransition(now);
+        sleep = std::min(sleep, std::chrono::duration_cast<ThreadTimer::Interval>(offsetChange - now) + ThreadTimer::Interval(1));
     }
 #endif
 
+    mIsInSchedule = scheduleResult;
+
+    const auto now    = Debouncer::Clock::now();
+    const auto delays = GetDebounceDelays(*settingsPtr);
+
+    scheduleResult = mScheduleDebouncer.Update(scheduleResult, now, delays);
+
+    const auto change = mScheduleDebouncer.GetChangeTime(delays);
+    if (change != Debouncer::Clock::time_point::max())
+    {
+        sleep = std::min(sleep, std::chrono::duration_cast<ThreadTimer::Interval>(change - now) + ThreadTimer::Interval(1));
+    }
+
+    mScheduleTimer.ChangeInterval(sleep);
+
     // Only if there is state change.
     {
         auto lockGuard = std::lock_guard<std::mutex>(mScanMutex);
@@ -149,54 +276,1088 @@ AutoMode::AutoMode (CaffeineAppSO app)
         , false
         , true
         )
+    , mIdleSource (std::make_unique<WindowsIdleTimeSource>())
+    , mScanTicks (0)
+    , mSkippedScans (0)
+    , mIsOnBattery (false)
+    , mScanOrder (GetScanners())
+    , mHasRule (false)
+    , mSettingsChanged (false)
+    , mRuleInvalidated (false)
+    , mRuleDevicesChanged (false)
+    , mRuleSessionsChanged (false)
+    , mScheduleChanged (true)
+    , mIsInSchedule (false)
 {
+    for (const auto scanner : GetScanners())
+    {
+        mScanSlots.try_emplace(scanner);
+    }
 }
 
-auto AutoMode::Start () -> bool
+auto AutoMode::GetScanInterval (const Settings& settings) const -> ThreadTimer::Interval
 {
-    mAppSO.DisableCaffeine();
+    if (mIsOnBattery && settings.Auto.BatteryScanInterval > 0)
+    {
+        return ThreadTimer::Interval(settings.Auto.BatteryScanInterval);
+    }
 
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
-    mScheduleResult = false;
-    mScheduleTimer.Start();
+    return ThreadTimer::Interval(settings.Auto.ScanInterval);
+}
+
+auto AutoMode::IsAllowedOnBattery (const Settings& settings, std::string_view trigger) const -> bool
+{
+    const auto& subset = settings.Auto.BatteryTriggers;
+    if (!mIsOnBattery || subset.empty())
+    {
+        return true;
+    }
+
+    return FindTrigger(subset, trigger) < subset.size();
+}
+
+auto AutoMode::IsTriggerActive (const Settings& settings, bool enabled, const Scanner& scanner) const -> bool
+{
+    return enabled && !mHasRule && IsAllowedOnBattery(settings, scanner.GetName());
+}
+
+auto AutoMode::GetTriggerConfig (const Settings& settings, const Scanner& scanner) const -> TriggerConfig
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
+    if (&scanner == &mProcessScanner)
+    {
+        return { settings.Auto.TriggerProcess.Enabled, settings.Auto.TriggerProcess.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
+    if (&scanner == &mWindowScanner)
+    {
+        return { settings.Auto.TriggerWindow.Enabled, settings.Auto.TriggerWindow.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN)
+    if (&scanner == &mFullscreenScanner)
+    {
+        return { settings.Auto.TriggerFullscreen.Enabled, settings.Auto.TriggerFullscreen.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    if (&scanner == &mUsbScanner)
+    {
+        return { settings.Auto.TriggerUsb.Enabled, settings.Auto.TriggerUsb.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    if (&scanner == &mBluetoothScanner)
+    {
+        return { settings.Auto.TriggerBluetooth.Enabled, settings.Auto.TriggerBluetooth.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK)
+    if (&scanner == &mNetworkScanner)
+    {
+        return { settings.Auto.TriggerNetwork.Enabled, settings.Auto.TriggerNetwork.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK)
+    if (&scanner == &mDiskScanner)
+    {
+        return { settings.Auto.TriggerDisk.Enabled, settings.Auto.TriggerDisk.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU)
+    if (&scanner == &mCpuScanner)
+    {
+        return { settings.Auto.TriggerCpu.Enabled, settings.Auto.TriggerCpu.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP)
+    if (&scanner == &mTcpScanner)
+    {
+        return { settings.Auto.TriggerTcp.Enabled, settings.Auto.TriggerTcp.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    if (&scanner == &mDirectoryScanner)
+    {
+        return { settings.Auto.TriggerDirectory.Enabled, settings.Auto.TriggerDirectory.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+    if (&scanner == &mRemoteSessionScanner)
+    {
+        return { settings.Auto.TriggerRemoteSession.Enabled, settings.Auto.TriggerRemoteSession.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB)
+    if (&scanner == &mJobScanner)
+    {
+        return { settings.Auto.TriggerJob.Enabled, settings.Auto.TriggerJob.ScanInterval };
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE)
+    if (&scanner == &mPidFileScanner)
+    {
+        return { settings.Auto.TriggerPidFile.Enabled, settings.Auto.TriggerPidFile.ScanInterval };
+    }
 #endif
 
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS) \
- || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW) \
- || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB) \
- || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    return TriggerConfig();
+}
+
+auto AutoMode::GetTriggerInterval (const Settings& settings, const TriggerConfig& config) const -> ScanClock::duration
+{
+    auto interval = config.ScanInterval > 0 ? config.ScanInterval : settings.Auto.ScanInterval;
+
+    // Battery interval is lower bound, triggers never scan more often.
+    if (mIsOnBattery && settings.Auto.BatteryScanInterval > 0)
+    {
+        interval = std::max(interval, settings.Auto.BatteryScanInterval);
+    }
+
+    return std::chrono::milliseconds(std::max(interval, 1u));
+}
+
+auto AutoMode::UpdateScanOrder (const Settings& settings) -> void
+{
+    // Scanners are ORed, so expected cost is lowest when ordered by cost
+    // per hit probability. Scanners without estimate go first to get one,
+    // stable sort keeps default order for ties. Priority triggers from
+    // settings always go before others.
+    const auto& priority = settings.Auto.PriorityTriggers;
+    const auto  rank     = [&](const Scanner* scanner)
+    {
+        const auto index = static_cast<double>(FindTrigger(priority, scanner->GetName()));
+        if (!scanner->HasEstimate())
+        {
+            return std::make_pair(index, -1.0);
+        }
+
+        return std::make_pair(index, scanner->GetMeanCost() / std::max(scanner->GetHitRate(), 0.01));
+    };
+
+    mPriorityTriggers = priority;
+
+    auto order = mScanOrder;
+    std::stable_sort(
+        order.begin(), order.end(), [&](const Scanner* a, const Scanner* b) { return rank(a) < rank(b); }
+    );
+
+    if (order != mScanOrder)
+    {
+        mScanOrder = std::move(order);
+        LOG_DEBUG("Scan order changed: {}", GetScanOrderText());
+    }
+
+    if (mHasRule)
+    {
+        OptimizeRule();
+    }
+}
+
+auto AutoMode::OnSourceChange (Scanner& scanner) -> void
+{
+    const auto it = mScanSlots.find(&scanner);
+    if (it != mScanSlots.end())
+    {
+        it->second.Changed = true;
+    }
+
+    mScannerTimer.Wake();
+}
+
+auto AutoMode::MarkAllChanged () -> void
+{
+    for (auto& [scanner, slot] : mScanSlots)
+    {
+        slot.Changed = true;
+    }
+}
+
+auto AutoMode::GetScanOrderText () const -> std::string
+{
+    auto text = std::string();
+    for (const auto scanner : mScanOrder)
+    {
+        if (!scanner->HasEstimate())
+        {
+            continue;
+        }
+
+        text += std::format(
+            "{}{} ({:.0f} us, {:.0f}%)",
+            text.empty() ? "" : ", ",
+            scanner->GetName(),
+            scanner->GetMeanCost(),
+            scanner->GetHitRate() * 100.0
+        );
+    }
+
+    return text;
+}
+
+auto AutoMode::ReadPowerSource () -> bool
+{
+    // Unknown status (255) is treated as AC.
+    auto status = SYSTEM_POWER_STATUS{};
+    const auto isOnBattery = GetSystemPowerStatus(&status) && status.ACLineStatus == 0;
+
+    return mIsOnBattery.exchange(isOnBattery) != isOnBattery;
+}
+
+auto AutoMode::OnPowerSourceChange () -> void
+{
+    if (!ReadPowerSource())
+    {
+        return;
+    }
+
+    // Idle timeouts are different for AC and battery.
+    if (mIdleSource)
+    {
+        mIdleSource->Invalidate();
+    }
+
+    // Trigger intervals depend on power source.
+    MarkAllChanged();
+
     const auto settingsPtr = mAppSO.GetSettings();
-    if (settingsPtr)
+    if (!settingsPtr)
     {
-        mScannerTimer.SetInterval(std::chrono::milliseconds(settingsPtr->Auto.ScanInterval));
+        return;
     }
 
-    mScannerResult = false;
-    mScannerTimer.Start();
-#endif
+    const auto acInterval      = std::max(settingsPtr->Auto.ScanInterval, 1u);
+    const auto batteryInterval = std::max(settingsPtr->Auto.BatteryScanInterval > 0 ? settingsPtr->Auto.BatteryScanInterval : acInterval, 1u);
+    const auto saved           = 3600 * 1000 / acInterval - std::min(3600 * 1000 / batteryInterval, 3600 * 1000 / acInterval);
 
-    LOG_TRACE("Started Auto mode");
+    if (mIsOnBattery)
+    {
+        LOG_INFO("Switched to battery, scan interval {} ms, ~{} fewer scanner wakeups per hour", batteryInterval, saved);
+    }
+    else
+    {
+        LOG_INFO("Switched to AC power, scan interval {} ms", acInterval);
+    }
 
-    return true;
+    mScannerTimer.ChangeInterval(GetScanInterval(*settingsPtr));
 }
 
-auto AutoMode::Stop () -> bool
+auto AutoMode::IsUserActive (const Settings& settings) -> bool
 {
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
-    mScheduleTimer.Stop();
-#endif
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS) \
- || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW) \
- || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB) \
- || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-    mScannerTimer.Stop();
-#endif
+    if (!mIdleSource)
+    {
+        return false;
+    }
 
-    mAppSO.DisableCaffeine();
+    const auto timeout = mIdleSource->GetIdleTimeout(settings.Auto.KeepScreenOn);
+    if (timeout == IdleTimeSource::Duration::zero())
+    {
+        return false;
+    }
 
-    LOG_TRACE("Stopped Auto mode");
+    // Resume early enough for at least two scans before timeout, using
+    // effective interval of slowest active trigger.
+    auto interval = std::chrono::duration_cast<IdleTimeSource::Duration>(GetScanInterval(settings));
+    for (const auto scanner : mScanOrder)
+    {
+        const auto config = GetTriggerConfig(settings, *scanner);
+        if (IsTriggerActive(settings, config.Enabled, *scanner))
+        {
+            interval = std::max(interval, std::chrono::duration_cast<IdleTimeSource::Duration>(GetTriggerInterval(settings, config)));
+        }
+    }
 
-    return true;
+    for (const auto& term : mRuleTerms)
+    {
+        if (term.Target)
+        {
+            interval = std::max(interval, std::chrono::duration_cast<IdleTimeSource::Duration>(GetTriggerInterval(settings, term.Config)));
+        }
+    }
+
+    const auto fraction  = std::min(settings.Auto.IdleScanFraction, 100u);
+    const auto threshold = std::min(timeout * fraction / 100, timeout - 2 * interval);
+
+    if (threshold <= IdleTimeSource::Duration::zero())
+    {
+        return false;
+    }
+
+    return mIdleSource->GetIdleTime() < threshold;
+}
+
+#pragma region "Rule"
+
+namespace {
+    // Number in decimal or 0x hex, whole string must match.
+    auto ParseNumber (const std::wstring& str, unsigned int& value) -> bool
+    {
+        if (str.empty())
+        {
+            return false;
+        }
+
+        auto end    = static_cast<wchar_t*>(nullptr);
+        const auto number = std::wcstoul(str.c_str(), &end, 0);
+        if (*end != L'\0' || number > UINT_MAX)
+        {
+            return false;
+        }
+
+        value = static_cast<unsigned int>(number);
+        return true;
+    }
+
+    // Rough tick cost of predicates in microseconds, used until scanner is
+    // measured. Cached and event driven triggers are cheap, process and
+    // device enumeration are not.
+    auto GetPredicateCost (std::wstring_view name) -> double
+    {
+        if (name == L"process")  return 2000.0;
+        if (name == L"usb")      return 1500.0;
+        if (name == L"tcp")      return 500.0;
+        if (name == L"window")   return 300.0;
+        if (name == L"network")  return 100.0;
+        if (name == L"disk")     return 100.0;
+        if (name == L"job")      return 100.0;
+        if (name == L"pidfile")  return 100.0;
+
+        return 20.0;
+    }
+
+    auto CreateScanner (std::wstring_view name) -> std::unique_ptr<Scanner>
+    {
+        if (name == L"process")       return std::make_unique<ProcessScanner>();
+        if (name == L"window")        return std::make_unique<WindowScanner>();
+        if (name == L"usb")           return std::make_unique<UsbDeviceScanner>();
+        if (name == L"network")       return std::make_unique<NetworkScanner>();
+        if (name == L"disk")          return std::make_unique<DiskScanner>();
+        if (name == L"cpu")           return std::make_unique<CpuScanner>();
+        if (name == L"tcp")           return std::make_unique<TcpScanner>();
+        if (name == L"remotesession") return std::make_unique<RemoteSessionScanner>();
+        if (name == L"job")           return std::make_unique<JobScanner>();
+        if (name == L"pidfile")       return std::make_unique<PidFileScanner>();
+
+        return nullptr;
+    }
+}
+
+auto AutoMode::GetScanners () -> std::vector<Scanner*>
+{
+    return {
+        &mProcessScanner,
+        &mWindowScanner,
+        &mFullscreenScanner,
+        &mUsbScanner,
+        &mBluetoothScanner,
+        &mNetworkScanner,
+        &mDiskScanner,
+        &mCpuScanner,
+        &mTcpScanner,
+        &mDirectoryScanner,
+        &mRemoteSessionScanner,
+        &mJobScanner,
+        &mPidFileScanner
+    };
+}
+
+auto AutoMode::IsTriggerUsed (bool enabled, const Scanner& scanner) const -> bool
+{
+    if (!mHasRule)
+    {
+        return enabled;
+    }
+
+    return std::any_of(
+        mRuleTerms.begin(), mRuleTerms.end(), [&](const RuleTerm& term) { return term.Target == &scanner; }
+    );
+}
+
+auto AutoMode::CreateRuleTerm (const RulePredicate& predicate, SettingsPtr settings, RuleTerm& term, std::wstring& error) -> bool
+{
+    const auto& name = predicate.Name;
+
+    if (name == L"schedule")
+    {
+        // Compiled from entries selected by name, all if none given.
+        const auto  names   = predicate.GetValues();
+        const auto& entries = settings->Auto.TriggerSchedule.ScheduleEntries;
+
+        auto selected = std::vector<ScheduleEntry>();
+        std::copy_if(
+            entries.begin(), entries.end(), std::back_inserter(selected),
+            [&](const ScheduleEntry& entry)
+            {
+                return names.empty() || std::find(names.begin(), names.end(), entry.Name) != names.end();
+            }
+        );
+
+        term.IsSchedule = true;
+        term.Schedule   = CompiledSchedule::Compile(selected);
+        return true;
+    }
+
+    // Without arguments use scanner and settings of the trigger.
+    if (predicate.Args.empty())
+    {
+        for (const auto scanner : GetScanners())
+        {
+            const auto scannerName = scanner->GetName();
+            if (name.size() == scannerName.size() && std::equal(
+                    name.begin(), name.end(), scannerName.begin(),
+                    [](wchar_t a, char b) { return a == std::towlower(static_cast<wchar_t>(b)); }
+                ))
+            {
+                term.Target = scanner;
+                term.Config = GetTriggerConfig(*settings, *scanner);
+                return true;
+            }
+        }
+
+        error = std::format(L"Unknown trigger '{}'", name);
+        return false;
+    }
+
+    term.Owned = CreateScanner(name);
+    if (!term.Owned)
+    {
+        error = std::format(L"Trigger '{}' doesn't take arguments", name);
+        return false;
+    }
+
+    term.Target   = term.Owned.get();
+    term.Settings = std::make_shared<Settings>(*settings);
+
+    // Interval of the trigger the scanner belongs to.
+    for (const auto scanner : GetScanners())
+    {
+        if (scanner->GetName() == term.Owned->GetName())
+        {
+            term.Config = GetTriggerConfig(*settings, *scanner);
+            break;
+        }
+    }
+
+    auto& a       = term.Settings->Auto;
+    auto values   = predicate.GetValues();
+    auto isValid  = true;
+
+    // Sets numeric setting from argument, marks term invalid on bad number.
+    const auto number = [&](const RuleArgument& arg, unsigned int& value) {
+        if (!ParseNumber(arg.Value, value))
+        {
+            error   = std::format(L"Invalid number '{}' in '{}'", arg.Value, name);
+            isValid = false;
+        }
+    };
+
+    auto vid = 0u;
+    auto pid = 0u;
+    auto cls = 0u;
+    auto hasVid = false;
+    auto hasPid = false;
+    auto hasCls = false;
+
+    // Keyed lists replace the trigger's lists, same as positional values.
+    auto listeners = std::vector<unsigned short>();
+    auto users     = std::vector<std::wstring>();
+    auto hosts     = std::vector<std::wstring>();
+
+    for (const auto& arg : predicate.Args)
+    {
+        const auto& key = arg.Key;
+        auto isKnown = key.empty();
+
+        if (name == L"network")
+        {
+            if (key == L"threshold")  { number(arg, a.TriggerNetwork.Threshold);    isKnown = true; }
+            if (key == L"off")        { number(arg, a.TriggerNetwork.OffThreshold); isKnown = true; }
+            if (key == L"window")     { number(arg, a.TriggerNetwork.Window);       isKnown = true; }
+        }
+        else if (name == L"disk")
+        {
+            if (key == L"threshold")  { number(arg, a.TriggerDisk.Threshold);        isKnown = true; }
+            if (key == L"off")        { number(arg, a.TriggerDisk.OffThreshold);     isKnown = true; }
+            if (key == L"iops")       { number(arg, a.TriggerDisk.IopsThreshold);    isKnown = true; }
+            if (key == L"iopsoff")    { number(arg, a.TriggerDisk.IopsOffThreshold); isKnown = true; }
+            if (key == L"window")     { number(arg, a.TriggerDisk.Window);           isKnown = true; }
+        }
+        else if (name == L"cpu")
+        {
+            if (key == L"threshold")  { number(arg, a.TriggerCpu.Threshold);    isKnown = true; }
+            if (key == L"off")        { number(arg, a.TriggerCpu.OffThreshold); isKnown = true; }
+            if (key == L"window")     { number(arg, a.TriggerCpu.Window);       isKnown = true; }
+        }
+        else if (name == L"job")
+        {
+            if (key == L"cpu")        { number(arg, a.TriggerJob.CpuThreshold); isKnown = true; }
+        }
+        else if (name == L"tcp")
+        {
+            if (key == L"port")       { values.push_back(arg.Value); isKnown = true; }
+            if (key == L"listen")
+            {
+                auto port = 0u;
+                if (!ParseNumber(arg.Value, port) || port == 0 || port > 0xFFFF)
+                {
+                    error   = std::format(L"Invalid port '{}' in '{}'", arg.Value, name);
+                    isValid = false;
+                }
+
+                listeners.push_back(static_cast<unsigned short>(port));
+                isKnown = true;
+            }
+        }
+        else if (name == L"pidfile")
+        {
+            if (key == L"lock")
+            {
+                auto lock = 0u;
+                number(arg, lock);
+                a.TriggerPidFile.LockFiles = lock != 0;
+                isKnown = true;
+            }
+        }
+        else if (name == L"remotesession")
+        {
+            if (key == L"user")       { users.push_back(arg.Value); isKnown = true; }
+            if (key == L"host")       { hosts.push_back(arg.Value); isKnown = true; }
+        }
+        else if (name == L"usb")
+        {
+            if (key == L"vid")        { number(arg, vid); hasVid = true; isKnown = true; }
+            if (key == L"pid")        { number(arg, pid); hasPid = true; isKnown = true; }
+            if (key == L"class")      { number(arg, cls); hasCls = true; isKnown = true; }
+        }
+
+        if (!isKnown)
+        {
+            error = std::format(L"Unknown argument '{}' in '{}'", key, name);
+            return false;
+        }
+    }
+
+    if (!isValid)
+    {
+        return false;
+    }
+
+    if (name == L"usb" && hasPid && !hasVid)
+    {
+        error = std::format(L"Argument 'pid' requires 'vid' in '{}'", name);
+        return false;
+    }
+
+    // Positional values replace list of the trigger.
+    if (name == L"process" && !values.empty())       a.TriggerProcess.Processes = values;
+    if (name == L"window" && !values.empty())        a.TriggerWindow.Windows    = values;
+    if (name == L"network" && !values.empty())       a.TriggerNetwork.Interfaces = values;
+    if (name == L"disk" && !values.empty())          a.TriggerDisk.Disks        = values;
+    if (name == L"job" && !values.empty())           a.TriggerJob.Jobs          = values;
+    if (name == L"pidfile" && !values.empty())       a.TriggerPidFile.Files     = values;
+
+    if (name == L"remotesession" && !values.empty())
+    {
+        error = std::format(L"Use user= or host= in '{}'", name);
+        return false;
+    }
+
+    if (name == L"cpu" && !values.empty())
+    {
+        error = std::format(L"Use threshold= in '{}'", name);
+        return false;
+    }
+
+    if (name == L"remotesession")
+    {
+        a.TriggerRemoteSession.Users = users;
+        a.TriggerRemoteSession.Hosts = hosts;
+    }
+
+    if (name == L"tcp" && (!values.empty() || !listeners.empty()))
+    {
+        a.TriggerTcp.Ports.clear();
+        a.TriggerTcp.Listeners = listeners;
+        for (const auto& value : values)
+        {
+            auto port = 0u;
+            if (!ParseNumber(value, port) || port == 0 || port > 0xFFFF)
+            {
+                error = std::format(L"Invalid port '{}' in '{}'", value, name);
+                return false;
+            }
+
+            a.TriggerTcp.Ports.push_back(static_cast<unsigned short>(port));
+        }
+    }
+
+    if (name == L"usb")
+    {
+        auto rules = std::vector<UsbDeviceRule>();
+        for (const auto& value : values)
+        {
+            rules.push_back(UsbDeviceRule::Parse(value));
+        }
+
+        if (hasCls)
+        {
+            rules.push_back(UsbDeviceRule::Parse(std::format(L"USB\\Class_{:02X}", cls)));
+        }
+        if (hasVid)
+        {
+            rules.push_back(UsbDeviceRule::Parse(
+                hasPid ? std::format(L"USB\\VID_{:04X}&PID_{:04X}", vid, pid) : std::format(L"USB\\VID_{:04X}", vid)
+            ));
+        }
+
+        if (!rules.empty())
+        {
+            a.TriggerUsb.UsbDevices = rules;
+        }
+    }
+
+    return true;
+}
+
+auto AutoMode::UpdateRule (SettingsPtr settings) -> bool
+{
+    // Always clear the flag, changed rule text is recompiled anyway.
+    const auto settingsChanged = mSettingsChanged.exchange(false);
+    if (settings->Auto.Rule == mRuleText && !settingsChanged)
+    {
+        return mHasRule;
+    }
+
+    const auto hadRule = mHasRule.load();
+
+    mHasRule = CompileRule(settings);
+
+    // Schedule trigger is evaluated by its own timer only without rule.
+    if (mHasRule != hadRule)
+    {
+        mScheduleTimer.Wake();
+    }
+
+    UpdateTrackers(settings);
+
+    return mHasRule;
+}
+
+auto AutoMode::CompileRule (SettingsPtr settings) -> bool
+{
+    const auto& text = settings->Auto.Rule;
+
+    mRuleText = text;
+    mRuleTerms.clear();
+
+    if (text.empty())
+    {
+        return false;
+    }
+
+    auto error = std::wstring();
+    if (!RuleExpression::Compile(text, mRule, error))
+    {
+        LOG_ERROR(L"Invalid trigger rule: {}", error);
+        return false;
+    }
+
+    const auto& predicates = mRule.GetPredicates();
+    for (const auto& predicate : predicates)
+    {
+        auto term = RuleTerm();
+        if (!CreateRuleTerm(predicate, settings, term, error))
+        {
+            LOG_ERROR(L"Invalid trigger rule: {}", error);
+            mRuleTerms.clear();
+            return false;
+        }
+
+        mRuleTerms.push_back(std::move(term));
+    }
+
+    OptimizeRule();
+
+    LOG_INFO(L"Using trigger rule {} ({} nodes, {} predicates)", mRule.ToString(), mRule.GetNodeCount(), predicates.size());
+
+    return true;
+}
+
+auto AutoMode::UpdateTrackers (SettingsPtr settings) -> void
+{
+    // Trackers only run for triggers used by rule or enabled without it,
+    // started and stopped as settings change.
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
+    const auto useWindow = IsTriggerUsed(settings->Auto.TriggerWindow.Enabled, mWindowScanner);
+    if (useWindow && !mWindowScanner.IsTracking())
+    {
+        // Don't wait for next tick when watched window appears/disappears.
+        mWindowScanner.StartTracking(settings, [this]{ OnSourceChange(mWindowScanner); });
+    }
+    else if (!useWindow && mWindowScanner.IsTracking())
+    {
+        mWindowScanner.StopTracking();
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN)
+    const auto useFullscreen = IsTriggerUsed(settings->Auto.TriggerFullscreen.Enabled, mFullscreenScanner);
+    if (useFullscreen && !mFullscreenScanner.IsTracking())
+    {
+        mFullscreenScanner.StartTracking([this]{ OnSourceChange(mFullscreenScanner); });
+    }
+    else if (!useFullscreen && mFullscreenScanner.IsTracking())
+    {
+        mFullscreenScanner.StopTracking();
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    const auto useUsb = IsTriggerUsed(settings->Auto.TriggerUsb.Enabled, mUsbScanner);
+    if (useUsb && !mUsbScanner.IsMonitoring())
+    {
+        mUsbScanner.StartMonitoring([this]{ OnSourceChange(mUsbScanner); });
+    }
+    else if (!useUsb && mUsbScanner.IsMonitoring())
+    {
+        mUsbScanner.StopMonitoring();
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    // Inquiry is started by first scan, only stopping is handled here.
+    const auto useBluetooth = IsTriggerUsed(settings->Auto.TriggerBluetooth.Enabled, mBluetoothScanner);
+    if (!useBluetooth && mBluetoothScanner.IsInquiryRunning())
+    {
+        mBluetoothScanner.StopInquiry();
+    }
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    // Directory list changes are handled by scanner itself.
+    const auto useDirectory = IsTriggerUsed(settings->Auto.TriggerDirectory.Enabled, mDirectoryScanner);
+    if (useDirectory && !mDirectoryScanner.IsStarted())
+    {
+        mDirectoryScanner.StartMonitoring(settings, [this]{ OnSourceChange(mDirectoryScanner); });
+    }
+    else if (!useDirectory && mDirectoryScanner.IsStarted())
+    {
+        mDirectoryScanner.StopMonitoring();
+    }
+#endif
+}
+
+auto AutoMode::OptimizeRule () -> void
+{
+    const auto& predicates = mRule.GetPredicates();
+
+    auto cost        = std::vector<double>();
+    auto probability = std::vector<double>();
+
+    for (auto i = size_t{0}; i < predicates.size(); ++i)
+    {
+        const auto& term = mRuleTerms[i];
+        if (term.Target && term.Target->HasEstimate())
+        {
+            cost.push_back(term.Target->GetMeanCost());
+            probability.push_back(term.Target->GetHitRate());
+        }
+        else
+        {
+            // Own scanner doesn't share caches with anything.
+            cost.push_back(GetPredicateCost(predicates[i].Name) * (term.Owned ? 1.5 : 1.0));
+            probability.push_back(0.5);
+        }
+    }
+
+    mRule.Optimize(cost, probability);
+}
+
+auto AutoMode::InvalidateRule () -> void
+{
+    const auto all      = mRuleInvalidated.exchange(false);
+    const auto devices  = mRuleDevicesChanged.exchange(false);
+    const auto sessions = mRuleSessionsChanged.exchange(false);
+
+    if (!all && !devices && !sessions)
+    {
+        return;
+    }
+
+    // Same scanners as fixed members in OnDeviceChange()/OnSessionChange().
+    for (auto& term : mRuleTerms)
+    {
+        if (!term.Owned)
+        {
+            continue;
+        }
+
+        const auto name = term.Owned->GetName();
+        if (all
+            || (devices && (name == "USB" || name == "Network"))
+            || (sessions && name == "RemoteSession"))
+        {
+            term.Owned->Invalidate();
+            term.Changed = true;
+        }
+    }
+}
+
+auto AutoMode::EvaluateRule (
+    SettingsPtr           settings,
+    const StopToken&      stop,
+    const PauseToken&     pause,
+    ScanClock::time_point now,
+    ScanClock::time_point& next
+) -> bool {
+    // Shared scanners report source changes through their slot, merged
+    // first so every term of the scanner sees them.
+    for (auto& term : mRuleTerms)
+    {
+        if (term.Target && !term.Owned && mScanSlots.at(term.Target).Changed.exchange(false))
+        {
+            term.Changed = true;
+        }
+    }
+
+    return mRule.Evaluate(
+        [&](size_t index)
+        {
+            auto& term = mRuleTerms[index];
+
+            if (term.IsSchedule)
+            {
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+                const auto weekTime = Schedule::GetWeekTime(mLocalTime.ToLocal(std::chrono::system_clock::now()));
+                const auto second   = static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::seconds>(weekTime).count());
+
+                // Other terms might not be due before schedule changes.
+                const auto transition = term.Schedule.GetNextTransition(second);
+                if (transition > 0)
+                {
+                    next = std::min(next, now + (std::chrono::seconds(second + transition) - weekTime));
+                }
+
+                return term.Schedule.IsActive(second);
+#else
+                return false;
+#endif
+            }
+
+            if (!term.Target || !IsAllowedOnBattery(*settings, term.Target->GetName()))
+            {
+                return false;
+            }
+
+            // Not due, last result is used.
+            if (std::exchange(term.Changed, false) || now >= term.NextScan)
+            {
+                term.Result   = term.Target->Scan(term.Settings ? term.Settings : settings, stop, pause);
+                term.NextScan = now + GetTriggerInterval(*settings, term.Config);
+            }
+
+            next = std::min(next, term.NextScan);
+
+            return term.Result;
+        }
+    );
+}
+
+#pragma endregion
+
+auto AutoMode::Start () -> bool
+{
+    mAppSO.DisableCaffeine();
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    mScheduleResult  = false;
+    mScheduleChanged = true;
+    mIsInSchedule    = false;
+    mScheduleDebouncer.Reset();
+#endif
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE)
+    const auto settingsPtr = mAppSO.GetSettings();
+    if (settingsPtr)
+    {
+        ReadPowerSource();
+        mScannerTimer.SetInterval(GetScanInterval(*settingsPtr));
+
+        // Force recompile, also starts trackers for used triggers.
+        mSettingsChanged = true;
+        UpdateRule(settingsPtr);
+    }
+
+    for (auto& [scanner, slot] : mScanSlots)
+    {
+        slot.NextScan = ScanClock::time_point();
+        slot.Result   = false;
+        slot.Changed  = true;
+    }
+
+    mScannerDebouncer.Reset();
+    mScannerResult = false;
+    mScanTicks     = 0;
+    mSkippedScans  = 0;
+    mScannerTimer.Start();
+#endif
+
+    // Started after rule is compiled, it decides if schedule is used.
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    mScheduleTimer.Start();
+#endif
+
+    LOG_TRACE("Started Auto mode");
+
+    return true;
+}
+
+auto AutoMode::Stop () -> bool
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
+    mScheduleTimer.Stop();
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB) \
+ || defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE)
+    mScannerTimer.Stop();
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
+    mWindowScanner.StopTracking();
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN)
+    mFullscreenScanner.StopTracking();
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    mUsbScanner.StopMonitoring();
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    mBluetoothScanner.StopInquiry();
+#endif
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    mDirectoryScanner.StopMonitoring();
+#endif
+
+    if (mScanTicks > 0)
+    {
+        LOG_INFO(
+            "Skipped {} of {} scans ({}%) while user was active",
+            mSkippedScans.load(), mScanTicks.load(), mSkippedScans * 100 / mScanTicks
+        );
+    }
+
+    LOG_INFO("Scan order: {}", GetScanOrderText());
+    LOG_INFO(
+        "Auto mode state changed {} times, {} short flips suppressed",
+        mScannerDebouncer.GetChanges() + mScheduleDebouncer.GetChanges(),
+        mScannerDebouncer.GetSuppressed() + mScheduleDebouncer.GetSuppressed()
+    );
+
+    mProcessScanner.LogStats();
+    mWindowScanner.LogStats();
+    mFullscreenScanner.LogStats();
+    mUsbScanner.LogStats();
+    mBluetoothScanner.LogStats();
+    mNetworkScanner.LogStats();
+    mDiskScanner.LogStats();
+    mCpuScanner.LogStats();
+    mTcpScanner.LogStats();
+    mDirectoryScanner.LogStats();
+    mRemoteSessionScanner.LogStats();
+    mJobScanner.LogStats();
+    mPidFileScanner.LogStats();
+
+    mAppSO.DisableCaffeine();
+
+    LOG_TRACE("Stopped Auto mode");
+
+    return true;
+}
+
+auto AutoMode::InvalidateScanners () -> void
+{
+    LOG_DEBUG("Invalidating scanner state");
+
+    mProcessScanner.Invalidate();
+    mWindowScanner.Invalidate();
+    mFullscreenScanner.Invalidate();
+    mUsbScanner.Invalidate();
+    mBluetoothScanner.Invalidate();
+    mNetworkScanner.Invalidate();
+    mDiskScanner.Invalidate();
+    mCpuScanner.Invalidate();
+    mTcpScanner.Invalidate();
+    mDirectoryScanner.Invalidate();
+    mRemoteSessionScanner.Invalidate();
+    mJobScanner.Invalidate();
+    mPidFileScanner.Invalidate();
+
+    mRuleInvalidated = true;
+
+    MarkAllChanged();
+    mScannerTimer.Wake();
+
+    // Schedule timer sleeps until next transition, clock might have moved
+    // while system was suspended.
+    mScheduleTimer.Wake();
+
+    if (mIdleSource)
+    {
+        mIdleSource->Invalidate();
+    }
+}
+
+auto AutoMode::OnDeviceChange () -> void
+{
+    LOG_DEBUG("Devices changed, invalidating device scanners");
+
+    // Fires for any devnode, e.g. audio endpoint or USB interface. Other
+    // scanners keep their baselines and intervals.
+    mUsbScanner.Invalidate();
+    mBluetoothScanner.Invalidate();
+    mNetworkScanner.Invalidate();
+
+    mRuleDevicesChanged = true;
+
+    OnSourceChange(mUsbScanner);
+    OnSourceChange(mBluetoothScanner);
+    OnSourceChange(mNetworkScanner);
+}
+
+auto AutoMode::OnTimeChange () -> void
+{
+    LOG_DEBUG("System time or time zone changed");
+
+    mLocalTime.Invalidate();
+    mScheduleTimer.Wake();
+}
+
+auto AutoMode::OnSessionChange () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+    mRemoteSessionScanner.Invalidate();
+    mRuleSessionsChanged = true;
+    OnSourceChange(mRemoteSessionScanner);
+#endif
 }
 
 auto AutoMode::GetIcon (CaffeineState state) const -> const HICON
@@ -0,0 +1,161 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "NetworkMonitor.hpp"
+
+#include "Logger.hpp"
+
+namespace CaffeineTake {
+
+auto NetworkMonitor::Resolve () -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK)
+    return false;
+#else
+    auto table  = PMIB_IF_TABLE2{nullptr};
+    auto result = GetIfTable2(&table);
+    if (result != NO_ERROR)
+    {
+        LOG_DEBUG("GetIfTable2() failed with error: {}", result);
+        return false;
+    }
+
+    // Keep last counters of interfaces that are still selected.
+    auto interfaces = std::vector<Interface>();
+    for (auto i = ULONG{0}; i < table->NumEntries; ++i)
+    {
+        const auto& row = table->Table[i];
+
+        // Filter drivers report the same traffic as the adapter below them.
+        if (row.InterfaceAndOperStatusFlags.FilterInterface || row.Type == IF_TYPE_SOFTWARE_LOOPBACK)
+        {
+            continue;
+        }
+
+        auto selected = false;
+        if (mNames.empty())
+        {
+            selected = row.InterfaceAndOperStatusFlags.HardwareInterface;
+        }
+        else
+        {
+            for (const auto& name : mNames)
+            {
+                if (_wcsicmp(name.c_str(), row.Alias) == 0 || _wcsicmp(name.c_str(), row.Description) == 0)
+                {
+                    selected = true;
+                    break;
+                }
+            }
+        }
+
+        if (!selected)
+        {
+            continue;
+        }
+
+        auto iface = Interface{ row, row.InOctets + row.OutOctets };
+        for (const auto& old : mInterfaces)
+        {
+            if (old.Row.InterfaceLuid.Value == row.InterfaceLuid.Value)
+            {
+                iface.LastOctets = old.LastOctets;
+                break;
+            }
+        }
+
+        interfaces.push_back(iface);
+    }
+
+    FreeMibTable(table);
+
+    if (interfaces.size() != mInterfaces.size())
+    {
+        LOG_DEBUG("Monitoring {} network interfaces", interfaces.size());
+    }
+
+    mInterfaces  = std::move(interfaces);
+    mIsResolved  = true;
+    mResolveTime = Clock::now();
+
+    return true;
+#endif
+}
+
+auto NetworkMonitor::SetInterfaces (const std::vector<std::wstring>& names) -> void
+{
+    if (mNames != names)
+    {
+        mNames = names;
+        mInterfaces.clear();
+        mIsResolved = false;
+    }
+}
+
+auto NetworkMonitor::Sample (unsigned long long& totalBytes) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK)
+    return false;
+#else
+    if (mInvalidated.exchange(false))
+    {
+        mIsResolved = false;
+    }
+
+    if (!mIsResolved || Clock::now() - mResolveTime > std::chrono::minutes(1))
+    {
+        if (!Resolve())
+        {
+            return false;
+        }
+    }
+
+    for (auto& iface : mInterfaces)
+    {
+        // Row already has interface LUID, only statistics are updated.
+        const auto result = GetIfEntry2(&iface.Row);
+        if (result != NO_ERROR)
+        {
+            // Adapter removed, resolve on next sample.
+            mIsResolved = false;
+            continue;
+        }
+
+        const auto octets = iface.Row.InOctets + iface.Row.OutOctets;
+
+        // Counters are reset when adapter is restarted.
+        if (octets >= iface.LastOctets)
+        {
+            mTotal += octets - iface.LastOctets;
+        }
+
+        iface.LastOctets = octets;
+    }
+
+    totalBytes = mTotal;
+
+    return true;
+#endif
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,80 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <winsock2.h>
+#include <iphlpapi.h>
+
+namespace CaffeineTake {
+
+// Reads byte counters of selected network interfaces. Interfaces are
+// resolved from full table only when selection changes, on device change
+// or once a minute, every sample only re-reads rows of selected interfaces
+// into buffers allocated at resolve time.
+class NetworkMonitor
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Interface
+    {
+        MIB_IF_ROW2        Row;
+        unsigned long long LastOctets = 0;
+    };
+
+    std::vector<Interface>    mInterfaces  = std::vector<Interface>();
+    std::vector<std::wstring> mNames       = std::vector<std::wstring>();  // empty means all hardware interfaces
+    unsigned long long        mTotal       = 0;
+    bool                      mIsResolved  = false;
+    Clock::time_point         mResolveTime = Clock::time_point();
+    std::atomic<bool>         mInvalidated = false;  // set from window thread, handled on next sample
+
+    auto Resolve () -> bool;
+
+public:
+    // Interface alias ("Ethernet") or description, re-resolves on change.
+    auto SetInterfaces (const std::vector<std::wstring>& names) -> void;
+
+    // Adapters might be added or removed.
+    auto Invalidate () -> void
+    {
+        mInvalidated = true;
+    }
+
+    // Total bytes received and sent by selected interfaces since monitor
+    // was created, counter resets and removed interfaces are accounted for.
+    auto Sample (unsigned long long& totalBytes) -> bool;
+
+    auto GetInterfaceCount () const -> size_t
+    {
+        return mInterfaces.size();
+    }
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,630 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "RuleExpression.hpp"
+
+#include <algorithm>
+#include <cwctype>
+#include <format>
+#include <limits>
+
+namespace CaffeineTake {
+
+#pragma region "RulePredicate"
+
+auto RulePredicate::GetValues () const -> std::vector<std::wstring>
+{
+    auto values = std::vector<std::wstring>();
+    for (const auto& arg : Args)
+    {
+        if (arg.Key.empty())
+        {
+            values.push_back(arg.Value);
+        }
+    }
+
+    return values;
+}
+
+auto RulePredicate::GetValue (std::wstring_view key, std::wstring_view def) const -> std::wstring
+{
+    for (const auto& arg : Args)
+    {
+        if (arg.Key == key)
+        {
+            return arg.Value;
+        }
+    }
+
+    return std::wstring(def);
+}
+
+#pragma endregion
+
+#pragma region "RuleParser"
+
+class RuleParser
+{
+    std::wstring_view mText;
+    size_t            mPos   = 0;
+    RuleExpression&   mExpr;
+    std::wstring&     mError;
+
+    auto Fail (std::wstring_view message) -> bool
+    {
+        if (mError.empty())
+        {
+            mError = std::format(L"{} at position {}", message, mPos + 1);
+        }
+
+        return false;
+    }
+
+    auto SkipSpace () -> void
+    {
+        while (mPos < mText.size() && std::iswspace(mText[mPos]))
+        {
+            ++mPos;
+        }
+    }
+
+    auto Accept (std::wstring_view token) -> bool
+    {
+        SkipSpace();
+        if (mText.substr(mPos, token.size()) == token)
+        {
+            mPos += token.size();
+            return true;
+        }
+
+        return false;
+    }
+
+    static auto IsNameChar (wchar_t c) -> bool
+    {
+        return std::iswalnum(c) || c == L'_';
+    }
+
+    // Bare argument value: numbers, ids, paths without spaces.
+    static auto IsWordChar (wchar_t c) -> bool
+    {
+        return !std::iswspace(c) && c != L'(' && c != L')' && c != L',' && c != L'=' && c != L'"' && c != L'!'
+            && c != L'&' && c != L'|';
+    }
+
+    auto ParseName (std::wstring& name) -> bool
+    {
+        SkipSpace();
+
+        const auto begin = mPos;
+        while (mPos < mText.size() && IsNameChar(mText[mPos]))
+        {
+            ++mPos;
+        }
+
+        if (mPos == begin || std::iswdigit(mText[begin]))
+        {
+            mPos = begin;
+            return false;
+        }
+
+        name = std::wstring(mText.substr(begin, mPos - begin));
+        return true;
+    }
+
+    auto ParseValue (std::wstring& value) -> bool
+    {
+        SkipSpace();
+
+        if (mPos < mText.size() && mText[mPos] == L'"')
+        {
+            ++mPos;
+            value.clear();
+
+            while (mPos < mText.size() && mText[mPos] != L'"')
+            {
+                // Only quote and backslash are escaped, so paths can be written as is.
+                if (mText[mPos] == L'\\' && mPos + 1 < mText.size() && (mText[mPos + 1] == L'"' || mText[mPos + 1] == L'\\'))
+                {
+                    ++mPos;
+                }
+
+                value.push_back(mText[mPos]);
+                ++mPos;
+            }
+
+            if (mPos == mText.size())
+            {
+                return Fail(L"Unterminated string");
+            }
+
+            ++mPos;
+            return true;
+        }
+
+        const auto begin = mPos;
+        while (mPos < mText.size() && IsWordChar(mText[mPos]))
+        {
+            ++mPos;
+        }
+
+        if (mPos == begin)
+        {
+            return Fail(L"Expected value");
+        }
+
+        value = std::wstring(mText.substr(begin, mPos - begin));
+        return true;
+    }
+
+    auto ParseArgument (RuleArgument& arg) -> bool
+    {
+        // name '=' value, or just value.
+        const auto begin = mPos;
+
+        auto key = std::wstring();
+        if (ParseName(key) && Accept(L"="))
+        {
+            std::transform(key.begin(), key.end(), key.begin(), std::towlower);
+            arg.Key = key;
+        }
+        else
+        {
+            mPos = begin;
+        }
+
+        return ParseValue(arg.Value);
+    }
+
+    auto ParsePrimary (size_t& node) -> bool
+    {
+        if (Accept(L"("))
+        {
+            if (!ParseOr(node))
+            {
+                return false;
+            }
+
+            return Accept(L")") || Fail(L"Expected ')'");
+        }
+
+        auto predicate = RulePredicate();
+        if (!ParseName(predicate.Name))
+        {
+            return Fail(L"Expected trigger name");
+        }
+
+        std::transform(predicate.Name.begin(), predicate.Name.end(), predicate.Name.begin(), std::towlower);
+
+        if (Accept(L"("))
+        {
+            if (!Accept(L")"))
+            {
+                do
+                {
+                    auto arg = RuleArgument();
+                    if (!ParseArgument(arg))
+                    {
+                        return false;
+                    }
+
+                    predicate.Args.push_back(std::move(arg));
+                }
+                while (Accept(L","));
+
+                if (!Accept(L")"))
+                {
+                    return Fail(L"Expected ')' or ','");
+                }
+            }
+        }
+        else if (predicate.Name == L"true" || predicate.Name == L"false")
+        {
+            node = mExpr.AddList(predicate.Name == L"true" ? RuleExpression::NodeType::And : RuleExpression::NodeType::Or, {});
+            return true;
+        }
+
+        node = mExpr.AddPredicate(std::move(predicate));
+        return true;
+    }
+
+    auto ParseUnary (size_t& node) -> bool
+    {
+        if (Accept(L"!"))
+        {
+            auto child = size_t{0};
+            if (!ParseUnary(child))
+            {
+                return false;
+            }
+
+            node = mExpr.AddNot(child);
+            return true;
+        }
+
+        return ParsePrimary(node);
+    }
+
+    auto ParseAnd (size_t& node) -> bool
+    {
+        auto children = std::vector<size_t>();
+        do
+        {
+            auto child = size_t{0};
+            if (!ParseUnary(child))
+            {
+                return false;
+            }
+
+            children.push_back(child);
+        }
+        while (Accept(L"&&"));
+
+        node = children.size() == 1 ? children[0] : mExpr.AddList(RuleExpression::NodeType::And, std::move(children));
+        return true;
+    }
+
+    auto ParseOr (size_t& node) -> bool
+    {
+        auto children = std::vector<size_t>();
+        do
+        {
+            auto child = size_t{0};
+            if (!ParseAnd(child))
+            {
+                return false;
+            }
+
+            children.push_back(child);
+        }
+        while (Accept(L"||"));
+
+        node = children.size() == 1 ? children[0] : mExpr.AddList(RuleExpression::NodeType::Or, std::move(children));
+        return true;
+    }
+
+public:
+    RuleParser (std::wstring_view text, RuleExpression& expr, std::wstring& error)
+        : mText  (text)
+        , mExpr  (expr)
+        , mError (error)
+    {
+    }
+
+    auto Parse () -> bool
+    {
+        auto root = size_t{0};
+        if (!ParseOr(root))
+        {
+            return false;
+        }
+
+        SkipSpace();
+        if (mPos != mText.size())
+        {
+            return Fail(L"Unexpected character");
+        }
+
+        mExpr.mRoot = root;
+        return true;
+    }
+};
+
+#pragma endregion
+
+#pragma region "RuleExpression"
+
+auto RuleExpression::AddNode (Node node) -> size_t
+{
+    // Key identifies node structurally, children are already unique.
+    auto key = std::wstring();
+    switch (node.Type)
+    {
+    case NodeType::False:     key = L"F"; break;
+    case NodeType::True:      key = L"T"; break;
+    case NodeType::Predicate: key = std::format(L"P{}", node.Predicate); break;
+    case NodeType::Not:       key = L"N"; break;
+    case NodeType::And:       key = L"A"; break;
+    case NodeType::Or:        key = L"O"; break;
+    }
+
+    for (const auto child : node.Children)
+    {
+        key += std::format(L",{}", child);
+    }
+
+    const auto it = mNodeIndex.find(key);
+    if (it != mNodeIndex.end())
+    {
+        return it->second;
+    }
+
+    mNodes.push_back(std::move(node));
+    mNodeIndex.emplace(key, mNodes.size() - 1);
+
+    return mNodes.size() - 1;
+}
+
+auto RuleExpression::AddPredicate (RulePredicate predicate) -> size_t
+{
+    auto index = static_cast<size_t>(std::find(mPredicates.begin(), mPredicates.end(), predicate) - mPredicates.begin());
+    if (index == mPredicates.size())
+    {
+        mPredicates.push_back(std::move(predicate));
+    }
+
+    return AddNode(Node{ .Type = NodeType::Predicate, .Predicate = index });
+}
+
+auto RuleExpression::AddNot (size_t child) -> size_t
+{
+    switch (mNodes[child].Type)
+    {
+    case NodeType::True:  return AddNode(Node{ .Type = NodeType::False });
+    case NodeType::False: return AddNode(Node{ .Type = NodeType::True });
+    case NodeType::Not:   return mNodes[child].Children[0];
+    default:              break;
+    }
+
+    return AddNode(Node{ .Type = NodeType::Not, .Children = { child } });
+}
+
+auto RuleExpression::AddList (NodeType type, std::vector<size_t> children) -> size_t
+{
+    // a && true == a, a && false == false, a || false == a, a || true == true
+    const auto identity = type == NodeType::And ? NodeType::True : NodeType::False;
+    const auto absorbing = type == NodeType::And ? NodeType::False : NodeType::True;
+
+    auto flat = std::vector<size_t>();
+    for (const auto child : children)
+    {
+        const auto& node = mNodes[child];
+        if (node.Type == absorbing)
+        {
+            return AddNode(Node{ .Type = absorbing });
+        }
+        else if (node.Type == identity)
+        {
+            continue;
+        }
+        else if (node.Type == type)
+        {
+            flat.insert(flat.end(), node.Children.begin(), node.Children.end());
+        }
+        else
+        {
+            flat.push_back(child);
+        }
+    }
+
+    std::sort(flat.begin(), flat.end());
+    flat.erase(std::unique(flat.begin(), flat.end()), flat.end());
+
+    if (flat.empty())
+    {
+        return AddNode(Node{ .Type = identity });
+    }
+    else if (flat.size() == 1)
+    {
+        return flat[0];
+    }
+
+    return AddNode(Node{ .Type = type, .Children = std::move(flat) });
+}
+
+auto RuleExpression::Compile (std::wstring_view text, RuleExpression& expression, std::wstring& error) -> bool
+{
+    expression = RuleExpression();
+    error.clear();
+
+    if (!RuleParser(text, expression, error).Parse())
+    {
+        expression = RuleExpression();
+        return false;
+    }
+
+    expression.Optimize(
+        std::vector<double>(expression.mPredicates.size(), 1.0),
+        std::vector<double>(expression.mPredicates.size(), 0.5)
+    );
+
+    return true;
+}
+
+auto RuleExpression::Optimize (const std::vector<double>& cost, const std::vector<double>& probability) -> void
+{
+    constexpr auto Infinity = std::numeric_limits<double>::infinity();
+
+    // Children come before parents, so single pass is enough.
+    for (auto& node : mNodes)
+    {
+        switch (node.Type)
+        {
+        case NodeType::False:
+            node.Cost        = 0.0;
+            node.Probability = 0.0;
+            break;
+
+        case NodeType::True:
+            node.Cost        = 0.0;
+            node.Probability = 1.0;
+            break;
+
+        case NodeType::Predicate:
+            node.Cost        = node.Predicate < cost.size() ? cost[node.Predicate] : 1.0;
+            node.Probability = node.Predicate < probability.size() ? probability[node.Predicate] : 0.5;
+            break;
+
+        case NodeType::Not:
+            node.Cost        = mNodes[node.Children[0]].Cost;
+            node.Probability = 1.0 - mNodes[node.Children[0]].Probability;
+            break;
+
+        case NodeType::And:
+        case NodeType::Or:
+        {
+            const auto isAnd = node.Type == NodeType::And;
+
+            // Probability that operand decides result (false for and, true
+            // for or), best operands first are cheap and likely to decide.
+            const auto decides = [&](size_t i) {
+                return isAnd ? 1.0 - mNodes[i].Probability : mNodes[i].Probability;
+            };
+            const auto rank = [&](size_t i) {
+                const auto d = decides(i);
+                return d > 0.0 ? mNodes[i].Cost / d : Infinity;
+            };
+
+            std::stable_sort(
+                node.Children.begin(), node.Children.end(), [&](size_t a, size_t b) { return rank(a) < rank(b); }
+            );
+
+            // Expected cost assuming independent operands.
+            auto expectedCost = 0.0;
+            auto reachChance  = 1.0;
+            for (const auto child : node.Children)
+            {
+                expectedCost += reachChance * mNodes[child].Cost;
+                reachChance  *= 1.0 - decides(child);
+            }
+
+            node.Cost        = expectedCost;
+            node.Probability = isAnd ? reachChance : 1.0 - reachChance;
+            break;
+        }
+        }
+    }
+}
+
+auto RuleExpression::EvaluateNode (size_t index, const EvaluateFn& evaluate) -> bool
+{
+    if (mMemo[index] >= 0)
+    {
+        return mMemo[index] != 0;
+    }
+
+    const auto& node = mNodes[index];
+
+    auto result = false;
+    switch (node.Type)
+    {
+    case NodeType::False:
+        result = false;
+        break;
+
+    case NodeType::True:
+        result = true;
+        break;
+
+    case NodeType::Predicate:
+        result = evaluate(node.Predicate);
+        break;
+
+    case NodeType::Not:
+        result = !EvaluateNode(node.Children[0], evaluate);
+        break;
+
+    case NodeType::And:
+        result = std::all_of(
+            node.Children.begin(), node.Children.end(), [&](size_t child) { return EvaluateNode(child, evaluate); }
+        );
+        break;
+
+    case NodeType::Or:
+        result = std::any_of(
+            node.Children.begin(), node.Children.end(), [&](size_t child) { return EvaluateNode(child, evaluate); }
+        );
+        break;
+    }
+
+    mMemo[index] = result ? 1 : 0;
+    return result;
+}
+
+auto RuleExpression::Evaluate (const EvaluateFn& evaluate) -> bool
+{
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    mMemo.assign(mNodes.size(), -1);
+    return EvaluateNode(mRoot, evaluate);
+}
+
+auto RuleExpression::ToString () const -> std::wstring
+{
+    if (mNodes.empty())
+    {
+        return L"false";
+    }
+
+    const auto print = [&](const auto& self, size_t index) -> std::wstring {
+        const auto& node = mNodes[index];
+        switch (node.Type)
+        {
+        case NodeType::False: return L"false";
+        case NodeType::True:  return L"true";
+        case NodeType::Not:   return L"!" + self(self, node.Children[0]);
+
+        case NodeType::Predicate:
+        {
+            const auto& predicate = mPredicates[node.Predicate];
+
+            auto str = predicate.Name + L"(";
+            for (auto i = size_t{0}; i < predicate.Args.size(); ++i)
+            {
+                const auto& arg = predicate.Args[i];
+                str += std::format(L"{}{}{}\"{}\"", i > 0 ? L", " : L"", arg.Key, arg.Key.empty() ? L"" : L"=", arg.Value);
+            }
+
+            return str + L")";
+        }
+
+        case NodeType::And:
+        case NodeType::Or:
+        {
+            auto str = std::wstring(L"(");
+            for (auto i = size_t{0}; i < node.Children.size(); ++i)
+            {
+                if (i > 0)
+                {
+                    str += node.Type == NodeType::And ? L" && " : L" || ";
+                }
+
+                str += self(self, node.Children[i]);
+            }
+
+            return str + L")";
+        }
+        }
+
+        return L"";
+    };
+
+    return print(print, mRoot);
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
@@ -0,0 +1,134 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace CaffeineTake {
+
+// Argument of rule predicate, key is empty for positional ones.
+struct RuleArgument
+{
+    std::wstring Key   = L"";
+    std::wstring Value = L"";
+
+    auto operator== (const RuleArgument& other) const -> bool = default;
+};
+
+// Leaf of rule expression, e.g. process("blender") or usb(vid=0x046d).
+struct RulePredicate
+{
+    std::wstring              Name = L"";   // lowercase
+    std::vector<RuleArgument> Args = std::vector<RuleArgument>();
+
+    auto operator== (const RulePredicate& other) const -> bool = default;
+
+    // Positional argument values.
+    auto GetValues () const -> std::vector<std::wstring>;
+
+    // Value of first argument with key, or def.
+    auto GetValue (std::wstring_view key, std::wstring_view def = L"") const -> std::wstring;
+};
+
+// Trigger rule expression, e.g.
+//   process("blender") && !schedule("night") || usb(vid=0x046d)
+//
+// Grammar:
+//   or        := and ('||' and)*
+//   and       := unary ('&&' unary)*
+//   unary     := '!' unary | primary
+//   primary   := '(' or ')' | 'true' | 'false' | predicate
+//   predicate := name ['(' [argument (',' argument)*] ')']
+//   argument  := [name '='] (string | word)
+//
+// Expression is compiled to DAG: equal subexpressions and predicates are
+// stored once (hash consing), nested and/or are flattened and constants are
+// folded. Nodes are topologically sorted, children come before parents.
+// Operands of and/or are ordered so that expected cost of short-circuit
+// evaluation is lowest, predicate is evaluated at most once per Evaluate.
+class RuleExpression
+{
+public:
+    enum class NodeType : unsigned char
+    {
+        False,
+        True,
+        Predicate,
+        Not,
+        And,
+        Or
+    };
+
+    struct Node
+    {
+        NodeType            Type        = NodeType::False;
+        size_t              Predicate   = 0;                    // for Predicate
+        std::vector<size_t> Children    = std::vector<size_t>();
+        double              Cost        = 0.0;                  // expected evaluation cost
+        double              Probability = 0.5;                  // of being true
+    };
+
+    using EvaluateFn = std::function<bool (size_t predicate)>;
+
+private:
+    std::vector<Node>                        mNodes      = std::vector<Node>();
+    std::vector<RulePredicate>               mPredicates = std::vector<RulePredicate>();
+    std::unordered_map<std::wstring, size_t> mNodeIndex  = std::unordered_map<std::wstring, size_t>();  // node key -> node
+    size_t                                   mRoot       = 0;
+    std::vector<signed char>                 mMemo       = std::vector<signed char>();  // -1 not evaluated
+
+    auto AddNode      (Node node) -> size_t;
+    auto AddPredicate (RulePredicate predicate) -> size_t;
+    auto AddNot       (size_t child) -> size_t;
+    auto AddList      (NodeType type, std::vector<size_t> children) -> size_t;
+
+    auto EvaluateNode (size_t index, const EvaluateFn& evaluate) -> bool;
+
+    friend class RuleParser;
+
+public:
+    // Returns false and sets error on syntax error.
+    static auto Compile (std::wstring_view text, RuleExpression& expression, std::wstring& error) -> bool;
+
+    // Order and/or operands by cost and probability of each predicate.
+    auto Optimize (const std::vector<double>& cost, const std::vector<double>& probability) -> void;
+
+    auto Evaluate (const EvaluateFn& evaluate) -> bool;
+
+    auto GetPredicates () const -> const std::vector<RulePredicate>&
+    {
+        return mPredicates;
+    }
+
+    auto GetNodeCount () const -> size_t
+    {
+        return mNodes.size();
+    }
+
+    auto ToString () const -> std::wstring;
+};
+
+} // namespace CaffeineTake
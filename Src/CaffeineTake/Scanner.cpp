@@ -24,26 +24,154 @@
 #include "Settings.hpp"
 #include "Logger.hpp"
 
+#include <algorithm>
+#include <array>
 #include <filesystem>
 #include <memory>
 #include <optional>
 
-#include <initguid.h>
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
-#   include <SetupAPI.h>
-#   include <usbiodef.h>
-#endif
+#include <Psapi.h>
 
-#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-#   include <bluetoothapis.h>
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+#   include <WtsApi32.h>
 #endif
 
 namespace CaffeineTake {
 
+#pragma region "Scanner"
+
+auto Scanner::UpdateEstimate (Clock::time_point start, bool result) -> bool
+{
+    const auto now  = Clock::now();
+    const auto cost = std::chrono::duration<double, std::micro>(now - start).count();
+
+    mCost.Add(now, cost, EstimateTime);
+    mHitRate.Add(now, result ? 1.0 : 0.0, EstimateTime);
+
+    if (result)
+    {
+        mStats.Hits += 1;
+    }
+
+    return result;
+}
+
+auto Scanner::Scan (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+    const auto start = Clock::now();
+
+    mStats.Ticks += 1;
+
+    if (RevalidateLastHit(settings))
+    {
+        mStats.Revalidated += 1;
+        mStats.ProbeTime   += Clock::now() - start;
+        mLastResult = true;
+        return UpdateEstimate(start, true);
+    }
+
+    // Always probe, so baseline is up to date after full scan.
+    const auto changed = HasChanged(settings);
+    const auto probed  = Clock::now();
+
+    mStats.ProbeTime += probed - start;
+
+    if (mHasResult && !mLastResult && !changed && probed - mLastFullScan < MaxGatedTime)
+    {
+        mStats.Gated += 1;
+        return UpdateEstimate(start, false);
+    }
+
+    mLastResult   = Run(settings, stop, pause);
+    mHasResult    = !stop;
+    mLastFullScan = Clock::now();
+
+    mStats.FullScans += 1;
+    mStats.ScanTime  += mLastFullScan - probed;
+
+    if (mLastFullScan - mLastStatsLog > std::chrono::hours(1))
+    {
+        LogStats();
+        mLastStatsLog = mLastFullScan;
+    }
+
+    // Interrupted scan says nothing about cost or hit rate.
+    if (stop)
+    {
+        return mLastResult;
+    }
+
+    return UpdateEstimate(start, mLastResult);
+}
+
+auto Scanner::LogStats () const -> void
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    using std::chrono::milliseconds;
+
+    if (mStats.Ticks == 0)
+    {
+        return;
+    }
+
+    const auto avgScan  = mStats.FullScans > 0 ? mStats.ScanTime / static_cast<long long>(mStats.FullScans) : std::chrono::nanoseconds(0);
+    const auto avgProbe = mStats.ProbeTime / static_cast<long long>(mStats.Ticks);
+    const auto skipped  = static_cast<long long>(mStats.Gated + mStats.Revalidated);
+    const auto saved    = avgScan * skipped - mStats.ProbeTime;
+
+    LOG_INFO(
+        "{} scanner: {} ticks, {} hits, {} revalidated, {} gated ({}%), {} full scans, avg scan {} us, avg probe {} us, ~{} ms saved",
+        GetName(),
+        mStats.Ticks,
+        mStats.Hits,
+        mStats.Revalidated,
+        mStats.Gated,
+        mStats.Gated * 100 / mStats.Ticks,
+        mStats.FullScans,
+        duration_cast<microseconds>(avgScan).count(),
+        duration_cast<microseconds>(avgProbe).count(),
+        duration_cast<milliseconds>(saved).count()
+    );
+}
+
+#pragma endregion
+
 #pragma region "ProcessScanner"
 
+namespace {
+    auto GetProcessStartTime (HANDLE process) -> FILETIME
+    {
+        auto creationTime = FILETIME{};
+        auto exitTime     = FILETIME{};
+        auto kernelTime   = FILETIME{};
+        auto userTime     = FILETIME{};
+        if (!GetProcessTimes(process, &creationTime, &exitTime, &kernelTime, &userTime))
+        {
+            return FILETIME{};
+        }
+
+        return creationTime;
+    }
+}
+
 auto ProcessScanner::CheckLast () -> bool
 {
+    // Pid might be reused by other process since it was found.
+    const auto process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, mLastPid);
+    if (!process)
+    {
+        return false;
+    }
+
+    const auto startTime = GetProcessStartTime(process);
+    CloseHandle(process);
+
+    if (CompareFileTime(&startTime, &mLastStartTime) != 0)
+    {
+        return false;
+    }
+
     auto path = GetProcessPath(mLastPid);
     if (!path.empty())
     {
@@ -60,33 +188,139 @@ auto ProcessScanner::CheckLast () -> bool
     return false;
 }
 
-auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+auto ProcessScanner::IsLastAlive () -> bool
+{
+    // Handle can't be reused by other process, unlike PID.
+    if (mLastProcess)
+    {
+        return WaitForSingleObject(mLastProcess, 0) == WAIT_TIMEOUT;
+    }
+
+    return CheckLast();
+}
+
+auto ProcessScanner::ResetLast () -> void
+{
+    if (mLastProcess)
+    {
+        CloseHandle(mLastProcess);
+        mLastProcess = NULL;
+    }
+
+    mLastProcessName.clear();
+    mLastProcessPath.clear();
+    mLastPid       = 0;
+    mLastStartTime = FILETIME();
+}
+
+auto ProcessScanner::HasChanged (SettingsPtr settings) -> bool
 {
 #if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
-    return false;
+    return true;
 #else
-    if (settings->Auto.TriggerProcess.Processes.empty())
+    auto changed = false;
+
+    if (mWatchedProcesses != settings->Auto.TriggerProcess.Processes)
     {
-        return false;
+        mWatchedProcesses = settings->Auto.TriggerProcess.Processes;
+        changed = true;
     }
 
-    // Only check last.
-    if (mLastPid != 0)
+    // Buffer is full if there are more processes, grow it and retry.
+    auto bytesReturned = DWORD{0};
+    while (true)
     {
-        if (CheckLast())
+        const auto bytes = static_cast<DWORD>(mPidBuffer.size() * sizeof(DWORD));
+        if (!EnumProcesses(mPidBuffer.data(), bytes, &bytesReturned))
         {
             return true;
         }
 
+        if (bytesReturned < bytes)
+        {
+            break;
+        }
+
+        mPidBuffer.resize(mPidBuffer.size() * 2);
+    }
+
+    // Order independent, EnumProcesses() order isn't guaranteed.
+    const auto count = bytesReturned / sizeof(DWORD);
+    auto hash = static_cast<unsigned long long>(count);
+    for (auto i = size_t{0}; i < count; ++i)
+    {
+        auto x = static_cast<unsigned long long>(mPidBuffer[i]) + 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        hash += x ^ (x >> 31);
+    }
+
+    if (hash != mPidHash)
+    {
+        mPidHash = hash;
+        changed  = true;
+    }
+
+    return changed;
+#endif
+}
+
+auto ProcessScanner::RevalidateLastHit (SettingsPtr settings) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
+    return false;
+#else
+    if (mLastPid == 0)
+    {
+        return false;
+    }
+
+    // Process might be removed from the list.
+    const auto& processes = settings->Auto.TriggerProcess.Processes;
+    const auto& last      = mLastProcessPath.empty() ? mLastProcessName : mLastProcessPath;
+    if (std::find(processes.begin(), processes.end(), last) == processes.end())
+    {
+        return false;
+    }
+
+    return IsLastAlive();
+#endif
+}
+
+auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PROCESS)
+    return false;
+#else
+    if (settings->Auto.TriggerProcess.Processes.empty())
+    {
+        return false;
+    }
+
+    // Previous hit failed revalidation, either process exited or it was
+    // removed from settings.
+    if (mLastPid != 0 && !IsLastAlive())
+    {
         const auto& last = mLastProcessPath.empty() ? mLastProcessName : mLastProcessPath;
         LOG_INFO(L"Process: {} (PID: {}), no longer exists, scanning all processes", last, mLastPid);
     }
 
-    mLastProcessName.clear();
-    mLastProcessPath.clear();
-    mLastPid = 0;
+    ResetLast();
+
+    // Keep handle to found process, exit can be checked without scanning.
+    // Duplicated from handle the path was read with, so it is the same
+    // process even if pid was reused meanwhile.
+    const auto keepProcess = [&](HANDLE handle, DWORD pid) {
+        mLastPid       = pid;
+        mLastStartTime = GetProcessStartTime(handle);
+
+        if (!DuplicateHandle(GetCurrentProcess(), handle, GetCurrentProcess(), &mLastProcess, SYNCHRONIZE, FALSE, 0))
+        {
+            mLastProcess = NULL;
+        }
+    };
 
-    return ScanProcesses(
+    const auto found = ScanProcesses(
         [&](HANDLE handle, DWORD pid, fs::path path)
         {
             for (const auto& proc : settings->Auto.TriggerProcess.Processes)
@@ -95,7 +329,7 @@ auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const Pau
                 if (proc == path)
                 {
                     mLastProcessPath = path;
-                    mLastPid         = pid;
+                    keepProcess(handle, pid);
 
                     LOG_INFO(L"Found process: {} (PID: {})", mLastProcessPath, pid);
                     return ScanResult::Success;
@@ -106,7 +340,7 @@ auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const Pau
                 if (proc == name)
                 {
                     mLastProcessName = name;
-                    mLastPid         = pid;
+                    keepProcess(handle, pid);
 
                     LOG_INFO(L"Found process: {} (PID: {})", mLastProcessName, pid);
                     return ScanResult::Success;
@@ -121,6 +355,8 @@ auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const Pau
             return ScanResult::Continue;
         }
     );
+
+    return found;
 #endif
 }
 
@@ -128,451 +364,747 @@ auto ProcessScanner::Run (SettingsPtr settings, const StopToken& stop, const Pau
 
 #pragma region "WindowScanner"
 
-auto WindowScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+auto WindowScanner::UpdateWatched (const std::vector<std::wstring>& windows) -> void
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mWatchedMutex);
+
+    if (mWatchedList != windows)
+    {
+        mWatchedList = windows;
+        mWatchedSet  = std::unordered_set<std::wstring>(windows.begin(), windows.end());
+    }
+}
+
+auto WindowScanner::StartTracking (SettingsPtr settings, ChangeFn onChange) -> bool
 {
 #if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
     return false;
 #else
-    if (settings->Auto.TriggerWindow.Windows.empty())
-    {
-        return false;
-    }
+    UpdateWatched(settings->Auto.TriggerWindow.Windows);
+    mOnChange = onChange;
 
-    return ScanWindows(
-        [&](HWND hWnd, DWORD pid, std::wstring_view window)
+    return mTracker.Start(
+        [this](std::wstring_view title)
         {
-            // Check if process is on window title list.
-            for (const auto& windowTitle : settings->Auto.TriggerWindow.Windows)
-            {
-                if (windowTitle == window)
-                {
-                    LOG_INFO(L"Found window: {} (PID: {})", windowTitle, pid);
-                    return ScanResult::Success;
-                }
-            }
+            auto lockGuard = std::lock_guard<std::mutex>(mWatchedMutex);
 
-            if (stop)
+            if (mOnChange && mWatchedSet.contains(std::wstring(title)))
             {
-                return ScanResult::Stop;
+                mOnChange();
             }
-
-            return ScanResult::Continue;
         }
     );
 #endif
 }
 
-#pragma endregion
+auto WindowScanner::StopTracking () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
+    mTracker.Stop();
+    mOnChange = nullptr;
+    mLastFoundWindow.clear();
+    mLastFoundHwnd = NULL;
+#endif
+}
 
-#pragma region "UsbDeviceScanenr"
+auto WindowScanner::HasChanged (SettingsPtr settings) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
+    return true;
+#else
+    if (!mTracker.IsRunning())
+    {
+        return true;
+    }
 
-auto UsbDeviceScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+    auto changed = false;
+
+    if (mLastWindows != settings->Auto.TriggerWindow.Windows)
+    {
+        mLastWindows = settings->Auto.TriggerWindow.Windows;
+        changed = true;
+    }
+
+    const auto generation = mTracker.GetGeneration();
+    if (generation != mLastGeneration)
+    {
+        mLastGeneration = generation;
+        changed = true;
+    }
+
+    return changed;
+#endif
+}
+
+auto WindowScanner::RevalidateLastHit (SettingsPtr settings) -> bool
 {
-#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
     return false;
 #else
-    if (settings->Auto.TriggerUsb.UsbDevices.empty())
+    if (mLastFoundWindow.empty())
     {
         return false;
     }
 
-    // Get list of USB devices that are present in the system.
-    auto deviceInfoSet = SetupDiGetClassDevsW(&GUID_DEVINTERFACE_USB_DEVICE, NULL, NULL, DIGCF_DEVICEINTERFACE | DIGCF_PRESENT);
-    if (deviceInfoSet == INVALID_HANDLE_VALUE)
+    if (mTracker.IsRunning())
+    {
+        UpdateWatched(settings->Auto.TriggerWindow.Windows);
+
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mWatchedMutex);
+            if (!mWatchedSet.contains(mLastFoundWindow))
+            {
+                return false;
+            }
+        }
+
+        return mTracker.Contains(mLastFoundWindow);
+    }
+
+    if (!mLastFoundHwnd || !IsWindow(mLastFoundHwnd) || !IsWindowVisible(mLastFoundHwnd))
     {
         return false;
     }
-    
-    auto deviceIndex = DWORD{0};
-    auto deviceInfoData = SP_DEVINFO_DATA{};
-    ZeroMemory(&deviceInfoData, sizeof(SP_DEVINFO_DATA));
-    deviceInfoData.cbSize = sizeof(SP_DEVINFO_DATA);
 
-    auto found = false;
-    auto buffer = std::vector<wchar_t>();
-    buffer.resize(1024);
+    // Window might be removed from the list.
+    const auto& windows = settings->Auto.TriggerWindow.Windows;
+    if (std::find(windows.begin(), windows.end(), mLastFoundWindow) == windows.end())
+    {
+        return false;
+    }
 
-    auto stopped = false;
-    auto error = DWORD{0};
-    while (error != ERROR_NO_MORE_ITEMS)
+    // Title can change while handle stays the same.
+    auto title = std::array<wchar_t, 512>{ 0 };
+    const auto length = GetWindowTextW(mLastFoundHwnd, title.data(), static_cast<int>(title.size()));
+
+    return std::wstring_view(title.data(), length) == mLastFoundWindow;
+#endif
+}
+
+auto WindowScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_WINDOW)
+    return false;
+#else
+    if (settings->Auto.TriggerWindow.Windows.empty())
     {
-        auto success = SetupDiEnumDeviceInfo(deviceInfoSet, deviceIndex, &deviceInfoData);
-        if (!success)
-        {
-            error = GetLastError();
+        return false;
+    }
 
-            if (error != ERROR_NO_MORE_ITEMS)
-            {
-                LOG_ERROR("SetupDiEnumDeviceInfo() failed with error: {}", error);
-                break;
-            }
-        }
-        else
+    // Window index is maintained by tracker, only lookup titles.
+    if (mTracker.IsRunning())
+    {
+        UpdateWatched(settings->Auto.TriggerWindow.Windows);
+
+        for (const auto& windowTitle : settings->Auto.TriggerWindow.Windows)
         {
-            // Get required buffer size.
-            auto requiredSize = DWORD{0};
-            success = SetupDiGetDeviceInstanceIdW(deviceInfoSet, &deviceInfoData, NULL, 0, &requiredSize);
-            if (!success)
+            if (mTracker.Contains(windowTitle))
             {
-                error = GetLastError();
-
-                if (error != ERROR_INSUFFICIENT_BUFFER)
+                if (mLastFoundWindow != windowTitle)
                 {
-                    LOG_ERROR("SetupDiGetDeviceInstanceIdW() failed with error: {}", error);
-                    break;
+                    LOG_INFO(L"Found window: {}", windowTitle);
+                    mLastFoundWindow = windowTitle;
                 }
-            }
 
-            // Resize buffer if needed.
-            if (requiredSize > buffer.capacity())
-            {
-                buffer.resize(requiredSize);
+                return true;
             }
+        }
 
-            // Get device id.
-            success = SetupDiGetDeviceInstanceIdW(deviceInfoSet, &deviceInfoData, buffer.data(), buffer.capacity(), &requiredSize);
-            if (!success)
-            {
-                error = GetLastError();
+        if (!mLastFoundWindow.empty())
+        {
+            LOG_INFO(L"Window '{}' no longer exists", mLastFoundWindow);
+            mLastFoundWindow.clear();
+        }
 
-                LOG_ERROR("SetupDiGetDeviceInstanceIdW() failed with error: {}", error);
-                break;
-            }
+        return false;
+    }
 
-            // Check if device is in the trigger list.
-            for (const auto& id : settings->Auto.TriggerUsb.UsbDevices)
+    auto found     = std::wstring();
+    auto foundHwnd = HWND{NULL};
+
+    ScanWindows(
+        [&](HWND hWnd, DWORD pid, std::wstring_view window)
+        {
+            // Check if process is on window title list.
+            for (const auto& windowTitle : settings->Auto.TriggerWindow.Windows)
             {
-                if (id == std::wstring_view(buffer.data()))
+                if (windowTitle == window)
                 {
-                    found = true;
-                    break;
+                    if (mLastFoundWindow != windowTitle)
+                    {
+                        LOG_INFO(L"Found window: {} (PID: {})", windowTitle, pid);
+                    }
+
+                    found     = windowTitle;
+                    foundHwnd = hWnd;
+                    return ScanResult::Success;
                 }
             }
 
             if (stop)
             {
-                stopped = true;
-                break;
+                return ScanResult::Stop;
             }
+
+            return ScanResult::Continue;
         }
+    );
 
-        deviceIndex++;
+    if (stop)
+    {
+        return false;
     }
 
-    // Cleanup.
-    if (deviceInfoSet)
+    if (found.empty() && !mLastFoundWindow.empty())
     {
-        SetupDiDestroyDeviceInfoList(deviceInfoSet);
+        LOG_INFO(L"Window '{}' no longer exists", mLastFoundWindow);
     }
 
-    if (!stopped)
-    {
-        if (found)
-        {
-            if (mLastFoundDevice != std::wstring_view(buffer.data()))
-            {
-                mLastFoundDevice = buffer.data();
-                LOG_INFO(L"Found present USB device: '{}'", mLastFoundDevice);
-            }
-        }
-        else
-        {
-            if (!mLastFoundDevice.empty())
-            {
-                LOG_INFO(L"USB Device '{}' is no longer present in system", mLastFoundDevice);
-            }
+    mLastFoundWindow = found;
+    mLastFoundHwnd   = foundHwnd;
 
-            mLastFoundDevice = L"";
-        }
-    }
-
-    return found;
+    return !found.empty();
 #endif
 }
 
 #pragma endregion
 
-#pragma region "BluetoothScanner"
+#pragma region "FullscreenScanner"
 
-auto BluetoothScanner::SystemTimeToChronoLocalTimePoint (const SYSTEMTIME& st)
+auto FullscreenScanner::IsIgnored (SettingsPtr settings, HWND hWnd) -> bool
 {
-    auto ft     = FILETIME{};
-    auto ft_utc = FILETIME{};
+    if (settings->Auto.TriggerFullscreen.IgnoredProcesses.empty())
+    {
+        return false;
+    }
 
-    if (SystemTimeToFileTime(&st, &ft))
+    // Process lookup only when foreground window changes.
+    if (hWnd == mLastWindow)
     {
-        if (LocalFileTimeToFileTime(&ft, &ft_utc))
-        {
-            const auto tz = std::chrono::current_zone();
-            const auto stp = FILETIME_to_system_clock(ft_utc);
+        return mLastIsIgnored;
+    }
+
+    auto pid = DWORD{0};
+    GetWindowThreadProcessId(hWnd, &pid);
 
-            return tz->to_local(stp);
+    const auto path = GetProcessPath(pid);
+    const auto name = path.filename();
+
+    auto ignored = false;
+    for (const auto& proc : settings->Auto.TriggerFullscreen.IgnoredProcesses)
+    {
+        if (proc == path || proc == name)
+        {
+            ignored = true;
+            break;
         }
     }
 
-    return std::chrono::local_time<std::chrono::system_clock::duration>();
+    mLastWindow    = hWnd;
+    mLastIsIgnored = ignored;
+
+    return ignored;
 }
 
-auto BluetoothScanner::ShouldPerformDeviceInquiry (const LocalTime& localTime, const std::chrono::seconds deviceActiveTimeout) -> bool
+auto FullscreenScanner::StartTracking (ChangeFn onChange) -> bool
 {
-    auto issueInquiry = true;
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN)
+    return false;
+#else
+    return mTracker.Start(onChange);
+#endif
+}
 
-    // If last inquiry was perfomed in less than mInquiryTimeout, skip.
-    const auto diff = localTime - mLastInquiryTime;
-    if (diff.count() > 0 && diff < mInquiryTimeout)
+auto FullscreenScanner::StopTracking () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN)
+    mTracker.Stop();
+    mLastWindow    = NULL;
+    mLastIsIgnored = false;
+    mLastResult    = false;
+#endif
+}
+
+auto FullscreenScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_FULLSCREEN)
+    return false;
+#else
+    auto hWnd         = HWND{NULL};
+    auto isFullscreen = false;
+
+    // Foreground state is maintained by tracker, fallback to direct check.
+    if (mTracker.IsRunning())
     {
-        issueInquiry = false;                
+        hWnd         = mTracker.GetForegroundWindow();
+        isFullscreen = mTracker.IsFullscreen();
     }
     else
     {
-        if (mLastSeenMap.empty())
+        hWnd         = GetForegroundWindow();
+        isFullscreen = IsWindowFullscreen(hWnd);
+    }
+
+    const auto result = isFullscreen && !IsIgnored(settings, hWnd);
+    if (result != mLastResult)
+    {
+        if (result)
         {
-            issueInquiry = false;
+            LOG_INFO("Foreground window is fullscreen");
         }
         else
         {
-            // Check if any device was last seen in deviceActiveTimeout.
-            for (const auto& [id, lastSeen] : mLastSeenMap)
-            {
-                const auto diff = localTime - lastSeen;
-                if (diff.count() > 0 && diff < deviceActiveTimeout)
-                {
-                    issueInquiry = false;
-                    break;
-                }
-            }
+            LOG_INFO("Foreground window is no longer fullscreen");
         }
+
+        mLastResult = result;
     }
 
-    return issueInquiry;
+    return result;
+#endif
 }
 
-auto BluetoothScanner::IssueDeviceInquiry () -> bool
+#pragma endregion
+
+#pragma region "UsbDeviceScanenr"
+
+auto UsbDeviceScanner::StartMonitoring (ChangeFn onChange) -> bool
 {
-#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
     return false;
 #else
-    LOG_TRACE("Starting bluetooth device inquiry");
-
-    auto result = true;
-
-    auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
-    ZeroMemory(&deviceInfo, sizeof(deviceInfo));
-    deviceInfo.dwSize = sizeof(deviceInfo);
-
-    auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
-        .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
-        .fReturnAuthenticated = TRUE,
-        .fReturnRemembered    = TRUE,
-        .fReturnUnknown       = TRUE,
-        .fReturnConnected     = TRUE,
-        .fIssueInquiry        = TRUE,
-        .cTimeoutMultiplier   = 1,    // n*1.28s
-        .hRadio               = NULL  // use all radios, for inquiry
-    };
+    return mHotplug.Start(onChange);
+#endif
+}
+
+auto UsbDeviceScanner::StopMonitoring () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    mHotplug.Stop();
+#endif
+}
+
+auto UsbDeviceScanner::Invalidate () -> void
+{
+    mHealth.Invalidate();
+    mDevicesChanged = true;
+}
+
+auto UsbDeviceScanner::HasChanged (SettingsPtr settings) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    return true;
+#else
+    auto changed = mDevicesChanged.exchange(false);
 
-    auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
-    if (deviceFind == NULL)
+    if (mHotplug.IsRunning())
     {
-        auto error = GetLastError();
-        if (error != ERROR_NO_MORE_ITEMS)
-        {
-            LOG_ERROR("IssueDeviceInquiry() failed with error {}", GetLastError());
-            result = false;
-        }
-        else
+        const auto generation = mHotplug.GetGeneration();
+        if (generation != mLastGeneration)
         {
-            LOG_DEBUG("IssueDeviceInquiry() no more items");
+            mLastGeneration = generation;
+            changed = true;
         }
     }
-    else
+
+    // Interfaces of composite device might be enumerated by now.
+    if (changed)
     {
-        BluetoothFindDeviceClose(deviceFind);
+        std::erase_if(mClassCache, [](const auto& entry) { return !IsUsbClassSetComplete(entry.second); });
     }
 
-    LOG_TRACE("Finished bluetooth device inqury");
+    if (mIndex.Build(settings->Auto.TriggerUsb.UsbDevices))
+    {
+        mClassCache.clear();
+        changed = true;
+    }
 
-    return result;
+    return changed;
 #endif
 }
 
-auto BluetoothScanner::CheckIfThereIsBluetoothRadio () -> bool
+auto UsbDeviceScanner::GetClasses (std::wstring_view instanceId, unsigned long long instanceIdHash) -> UsbClassSet
 {
-#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    const auto it = mClassCache.find(instanceIdHash);
+    if (it != mClassCache.end())
+    {
+        return it->second;
+    }
+
+    // Incomplete sets are cached too, dropped on next device change.
+    const auto classes = GetUsbDeviceClasses(instanceId);
+    mClassCache.emplace(instanceIdHash, classes);
+
+    return classes;
+}
+
+auto UsbDeviceScanner::RevalidateLastHit (SettingsPtr settings) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
     return false;
 #else
-    auto params = BLUETOOTH_FIND_RADIO_PARAMS{
-        .dwSize = sizeof(BLUETOOTH_FIND_RADIO_PARAMS)
-    };
+    if (mLastFoundDevice.empty())
+    {
+        return false;
+    }
 
-    auto found = false;
+    // Rules changed, device might not match anymore.
+    if (mIndex.Build(settings->Auto.TriggerUsb.UsbDevices))
+    {
+        mClassCache.clear();
+        return false;
+    }
 
-    auto radio = INVALID_HANDLE_VALUE;
-    auto hRadioFind = BluetoothFindFirstRadio(&params, &radio);
-    if (hRadioFind)
+    if (mHotplug.IsRunning())
     {
-        BluetoothFindRadioClose(hRadioFind);
-        found = true;
+        return mHotplug.Contains(mLastFoundDevice);
     }
 
-    return found;
+    return IsUsbDevicePresent(mLastFoundDevice);
 #endif
 }
 
-auto BluetoothScanner::EnumerateBluetoothDevices (
-    SettingsPtr                settings,
-    const LocalTime&           localTime,
-    const std::chrono::seconds deviceActiveTimeout,
-    const StopToken&           stop
-) -> BluetoothIdentifier
+auto UsbDeviceScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
 {
-#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
-    return BluetoothIdentifier();
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    return false;
 #else
-    auto deviceInfo = BLUETOOTH_DEVICE_INFO{};
-    ZeroMemory(&deviceInfo, sizeof(deviceInfo));
-    deviceInfo.dwSize = sizeof(deviceInfo);
-
-    auto searchParams = BLUETOOTH_DEVICE_SEARCH_PARAMS{
-        .dwSize               = sizeof(BLUETOOTH_DEVICE_SEARCH_PARAMS),
-        .fReturnAuthenticated = TRUE,
-        .fReturnRemembered    = TRUE,
-        .fReturnUnknown       = TRUE,
-        .fReturnConnected     = TRUE,
-        .fIssueInquiry        = FALSE,
-        .cTimeoutMultiplier   = 0,
-        .hRadio               = NULL  // use all radios, for inquiry
-    };
+    if (settings->Auto.TriggerUsb.UsbDevices.empty())
+    {
+        return false;
+    }
+
+    // Rules are parsed when settings are loaded, index is rebuilt only when they change.
+    if (mIndex.Build(settings->Auto.TriggerUsb.UsbDevices))
+    {
+        mClassCache.clear();
+    }
+
+    auto found   = std::wstring();
+    auto stopped = false;
+
+    // Present devices are maintained by hotplug monitor, fallback to polling.
+    if (mHotplug.IsRunning())
+    {
+        found = mHotplug.Find(mIndex);
+    }
+    else
+    {
+        // Keep last result while device list can't be read.
+        if (!mHealth.CanRun())
+        {
+            return !mLastFoundDevice.empty();
+        }
+
+        const auto result = mSource->Enumerate(
+            [&](std::wstring_view instanceId)
+            {
+                auto device = UsbDeviceInfo::Parse(instanceId);
+                if (mIndex.NeedsClasses())
+                {
+                    device.Classes = GetClasses(instanceId, device.InstanceIdHash);
+                }
+
+                // Check if device matches any trigger rule.
+                if (mIndex.Match(device))
+                {
+                    found = instanceId;
+                    return ScanResult::Success;
+                }
+
+                if (stop)
+                {
+                    return ScanResult::Stop;
+                }
+
+                return ScanResult::Continue;
+            }
+        );
 
-    auto found = BluetoothIdentifier();
-    auto deviceFind = BluetoothFindFirstDevice(&searchParams, &deviceInfo);
-    if (deviceFind == NULL)
+        if (result == ScanResult::Failure)
+        {
+            mHealth.OnFailure("can't read USB device list");
+            return !mLastFoundDevice.empty();
+        }
+
+        mHealth.OnSuccess();
+        stopped = result == ScanResult::Stop;
+    }
+
+    if (!stopped)
     {
-        auto error = GetLastError();
-        if (error != ERROR_NO_MORE_ITEMS)
+        if (!found.empty())
         {
-            LOG_ERROR("BluetoothFindFirstDevice() failed with error {}", GetLastError());
+            if (mLastFoundDevice != found)
+            {
+                mLastFoundDevice = found;
+                LOG_INFO(L"Found present USB device: '{}'", mLastFoundDevice);
+            }
         }
         else
         {
-            LOG_DEBUG("BluetoothFindFirstDevice() no more items");
+            if (!mLastFoundDevice.empty())
+            {
+                LOG_INFO(L"USB Device '{}' is no longer present in system", mLastFoundDevice);
+            }
+
+            mLastFoundDevice = L"";
         }
     }
+
+    return !found.empty();
+#endif
+}
+
+#pragma endregion
+
+#pragma region "BluetoothScanner"
+
+BluetoothScanner::BluetoothScanner (std::unique_ptr<BluetoothRadio> radio)
+    : mRadio        (std::move(radio))
+    , mInquiryTimer (
+        [this](const StopToken& stop, const PauseToken& pause)
+        {
+            Refresh(stop);
+            return true;
+        },
+        ThreadTimer::Interval(mInquiryTimeout),
+        false,
+        true
+    )
+{
+}
+
+auto BluetoothScanner::ShouldPerformDeviceInquiry (const SystemTimePoint& now, const std::chrono::seconds deviceActiveTimeout) -> bool
+{
+    auto issueInquiry = true;
+
+    // If last inquiry was perfomed in less than mInquiryTimeout, skip.
+    const auto diff = now - mLastInquiryTime;
+    if (diff.count() > 0 && diff < mInquiryTimeout)
+    {
+        issueInquiry = false;                
+    }
     else
     {
-        do
+        auto lockGuard = std::lock_guard<std::mutex>(mCacheMutex);
+
+        if (mDevices.empty())
+        {
+            issueInquiry = false;
+        }
+        else
         {
-            // Check if device is in the trigger list.
-            for (const auto& id : settings->Auto.TriggerBluetooth.BluetoothDevices)
+            // Check if any device was last seen in deviceActiveTimeout.
+            for (const auto& [id, device] : mDevices)
             {
-                if (id == deviceInfo.Address.ullLong)
+                const auto diff = now - device.LastSeen;
+                if (diff.count() > 0 && diff < deviceActiveTimeout)
                 {
-                    // If device was seen in last mTimeoutDuration we consider it connected.
-                    // If device wasn't seen in last mTimeoutDuration we will issue inquiry in next run*.
-                    // * unless there is other device connected or seen in last mTimeoutDuration
-                        
-                    // Update last seen. deviceInfo.stLastSeen is expected to be in local time.
-                    const auto lastSeen = SystemTimeToChronoLocalTimePoint(deviceInfo.stLastSeen);
-                    mLastSeenMap[id.ull] = lastSeen;
+                    issueInquiry = false;
+                    break;
+                }
+            }
+        }
+    }
 
-                    const auto uniqid = id.ToWString();
+    return issueInquiry;
+}
 
-                    if (deviceInfo.fConnected)
-                    {
-                        found = id;
-
-                        if (mLastFoundDevice != id)
-                        {
-                            const auto name = std::wstring(deviceInfo.szName);
-                            LOG_INFO(L"Found connected Bluetooth device '{}' ({})", uniqid, name);
-                            mLastFoundDevice = id;
-                        }
-                            
-                        // Stop iterating.
-                        break;
-                    }
-                    else
-                    {
-                        const auto diff = std::chrono::duration_cast<std::chrono::seconds>(localTime - lastSeen);
-                        if (diff < deviceActiveTimeout)
-                        {
-                            if (found.IsInvalid())
-                            {
-                                found = id;
-
-                                const auto name = std::wstring(deviceInfo.szName);
-                                const auto diffStr = std::format(L"{}", diff);
-
-                                if (found != mLastFoundDevice)
-                                {
-                                    LOG_INFO(L"Bluetooth device '{}' ({}) was last seen in {}", uniqid, name, diffStr);
-                                }
-                            }
-                        }
-
-                        // Continue!
-                    }
+auto BluetoothScanner::Refresh (const StopToken& stop) -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
+    // Check if there is bluetooth adapter, radio is probed again only after
+    // device change, resume or failure.
+    mIsRadioPresent = mHealth.GetCapability([this]{ return mRadio->IsPresent(); });
+    if (!mIsRadioPresent)
+    {
+        return;
+    }
+
+    if (!mHealth.CanRun())
+    {
+        return;
+    }
+
+    const auto deviceActiveTimeout = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::milliseconds(mActiveTimeoutMs.load())
+    );
+
+    // If we see didn't see at least one device in last mTimeoutDuration, issue inquiry.
+    // This blocks for few seconds, but only this thread.
+    const auto now = std::chrono::system_clock::now();
+    if (ShouldPerformDeviceInquiry(now, deviceActiveTimeout))
+    {
+        if (mRadio->Inquiry())
+        {
+            LOG_INFO("Finished Bluetooth device inquiry");
+            mLastInquiryTime = now;
+        }
+        else
+        {
+            mHealth.OnFailure("device inquiry failed");
+            return;
+        }
+    }
+
+    if (stop)
+    {
+        return;
+    }
+
+    auto triggerDevices = std::vector<BluetoothIdentifier>();
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mCacheMutex);
+        triggerDevices = mTriggerDevices;
+    }
+
+    // Enumerate bluetooth devices, keep only the ones in the trigger list.
+    auto devices = DeviceMap();
+    const auto result = mRadio->EnumerateDevices(
+        [&](const BluetoothDeviceRecord& record)
+        {
+            for (const auto& id : triggerDevices)
+            {
+                if (id == record.Id)
+                {
+                    devices[id.ull] = CachedDevice{ record.Name, record.IsConnected, record.LastSeen };
+                    break;
                 }
             }
+        },
+        stop
+    );
 
-            if (stop)
+    if (!result)
+    {
+        mHealth.OnFailure("device enumeration failed");
+        return;
+    }
+
+    mHealth.OnSuccess();
+
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mCacheMutex);
+
+        // Device not returned by enumeration keeps its last seen time.
+        for (auto& [id, device] : mDevices)
+        {
+            if (!devices.contains(id))
             {
-                break;
+                device.IsConnected = false;
+                devices.emplace(id, device);
             }
-        } while (BluetoothFindNextDevice(deviceFind, &deviceInfo));
-        
-        BluetoothFindDeviceClose(deviceFind);
-    }
+        }
 
-    return found;
+        mDevices = std::move(devices);
+    }
 #endif
 }
 
+auto BluetoothScanner::StopInquiry () -> void
+{
+    mInquiryTimer.Stop();
+}
+
+auto BluetoothScanner::Invalidate () -> void
+{
+    mHealth.Invalidate();
+    mInquiryTimer.Wake();
+}
+
 auto BluetoothScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
 {
 #if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_BLUETOOTH)
     return false;
 #else
-    if (settings->Auto.TriggerBluetooth.BluetoothDevices.empty())
+    const auto& triggerDevices = settings->Auto.TriggerBluetooth.BluetoothDevices;
+    if (triggerDevices.empty())
     {
         return false;
     }
 
-    // Check if there is bluetooth adapter.
-    if (!CheckIfThereIsBluetoothRadio())
+    mActiveTimeoutMs = settings->Auto.TriggerBluetooth.ActiveTimeout;
+
     {
-        LOG_DEBUG("No Bluetooth adapter found");
-        return false;
+        auto lockGuard = std::lock_guard<std::mutex>(mCacheMutex);
+        if (mTriggerDevices != triggerDevices)
+        {
+            mTriggerDevices = triggerDevices;
+        }
+    }
+
+    // Results are from previous refresh, request new one for the next tick.
+    if (!mInquiryTimer.IsRunning())
+    {
+        mInquiryTimer.Start();
+    }
+    else
+    {
+        mInquiryTimer.Wake();
     }
 
-    // For some reason system keeps loading/unloading this library.
-    // Load manually to keep at least one reference.
-    if (!mLibBluetoothApis)
+    if (!mIsRadioPresent)
     {
-        mLibBluetoothApis = LoadLibraryW(L"bluetoothapis.dll");
+        return false;
     }
 
     const auto deviceActiveTimeout = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::milliseconds(settings->Auto.TriggerBluetooth.ActiveTimeout)
     );
 
-    const auto tz = std::chrono::current_zone();
-    const auto localTime = tz->to_local(std::chrono::system_clock::now());
+    const auto now = std::chrono::system_clock::now();
 
-    // If we see didn't see at least one device in last mTimeoutDuration, issue inquiry.
-    if (ShouldPerformDeviceInquiry(localTime, deviceActiveTimeout))
+    // If device was seen in last deviceActiveTimeout we consider it connected.
+    // If device wasn't seen in last deviceActiveTimeout inquiry is issued in
+    // next refresh, unless there is other device connected or seen recently.
+    auto found       = BluetoothIdentifier();
+    auto foundName   = std::wstring();
+    auto isConnected = false;
+    auto lastSeen    = std::chrono::seconds(0);
     {
-        if (IssueDeviceInquiry())
+        auto lockGuard = std::lock_guard<std::mutex>(mCacheMutex);
+
+        for (const auto& id : triggerDevices)
         {
-            LOG_INFO("Finished Bluetooth device inquiry");
-            mLastInquiryTime = localTime;
-        }
-    }
+            const auto it = mDevices.find(id.ull);
+            if (it == mDevices.end())
+            {
+                continue;
+            }
 
-    // Enumerate bluetooth devices.
-    auto found = EnumerateBluetoothDevices(settings, localTime, deviceActiveTimeout, stop);
+            const auto& device = it->second;
+            if (device.IsConnected)
+            {
+                found       = id;
+                foundName   = device.Name;
+                isConnected = true;
+                break;
+            }
 
-    if (found.IsInvalid() && mLastFoundDevice.IsValid())
+            const auto diff = std::chrono::duration_cast<std::chrono::seconds>(now - device.LastSeen);
+            if (diff < deviceActiveTimeout && found.IsInvalid())
+            {
+                found     = id;
+                foundName = device.Name;
+                lastSeen  = diff;
+            }
+        }
+    }
+
+    if (found.IsValid() && found != mLastFoundDevice)
+    {
+        if (isConnected)
+        {
+            LOG_INFO(L"Found connected Bluetooth device '{}' ({})", found.ToWString(), foundName);
+        }
+        else
+        {
+            LOG_INFO(L"Bluetooth device '{}' ({}) was last seen in {}", found.ToWString(), foundName, std::format(L"{}", lastSeen));
+        }
+    }
+
+    if (found.IsInvalid() && mLastFoundDevice.IsValid())
     {
         LOG_INFO(L"Bluetooth device '{}' is no longer connected", mLastFoundDevice.ToWString());
     }
@@ -588,4 +1120,830 @@ auto BluetoothScanner::Run (SettingsPtr settings, const StopToken& stop, const P
 
 #pragma endregion
 
+#pragma region "NetworkScanner"
+
+auto NetworkScanner::Invalidate () -> void
+{
+    mHealth.Invalidate();
+    mMonitor.Invalidate();
+}
+
+auto NetworkScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_NETWORK)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerNetwork;
+    if (trigger.Threshold == 0)
+    {
+        return false;
+    }
+
+    // Keep last state while statistics can't be read.
+    if (!mHealth.CanRun())
+    {
+        return mThreshold.IsActive();
+    }
+
+    mMonitor.SetInterfaces(trigger.Interfaces);
+
+    auto totalBytes = 0ull;
+    if (!mMonitor.Sample(totalBytes))
+    {
+        mHealth.OnFailure("can't read network interface statistics");
+        return mThreshold.IsActive();
+    }
+
+    mHealth.OnSuccess();
+
+    mRate.Add(RateWindow::Clock::now(), totalBytes, std::chrono::milliseconds(trigger.Window));
+
+    const auto rate      = mRate.GetRate() / 1024.0;
+    const auto wasActive = mThreshold.IsActive();
+    const auto isActive  = mThreshold.Update(rate, trigger.Threshold, trigger.OffThreshold);
+
+    if (isActive != wasActive)
+    {
+        LOG_INFO(
+            "Network throughput {} KiB/s, {} threshold ({} interfaces)",
+            static_cast<unsigned long long>(rate), isActive ? "above" : "below", mMonitor.GetInterfaceCount()
+        );
+    }
+
+    return isActive;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "DiskScanner"
+
+auto DiskScanner::Invalidate () -> void
+{
+    mHealth.Invalidate();
+    mMonitor.Invalidate();
+}
+
+auto DiskScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DISK)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerDisk;
+    if (trigger.Threshold == 0 && trigger.IopsThreshold == 0)
+    {
+        return false;
+    }
+
+    const auto wasActive = mBytesThreshold.IsActive() || mOpsThreshold.IsActive();
+
+    // Keep last state while counters can't be read.
+    if (!mHealth.CanRun())
+    {
+        return wasActive;
+    }
+
+    mMonitor.SetDisks(trigger.Disks);
+
+    auto totalBytes = 0ull;
+    auto totalOps   = 0ull;
+    if (!mMonitor.Sample(totalBytes, totalOps))
+    {
+        mHealth.OnFailure("can't read disk performance counters");
+        return wasActive;
+    }
+
+    mHealth.OnSuccess();
+
+    const auto now    = RateWindow::Clock::now();
+    const auto window = std::chrono::milliseconds(trigger.Window);
+
+    mBytesRate.Add(now, totalBytes, window);
+    mOpsRate.Add(now, totalOps, window);
+
+    const auto bytesRate = mBytesRate.GetRate() / 1024.0;
+    const auto opsRate   = mOpsRate.GetRate();
+
+    auto isActive = false;
+    if (trigger.Threshold > 0)
+    {
+        isActive |= mBytesThreshold.Update(bytesRate, trigger.Threshold, trigger.OffThreshold);
+    }
+    if (trigger.IopsThreshold > 0)
+    {
+        isActive |= mOpsThreshold.Update(opsRate, trigger.IopsThreshold, trigger.IopsOffThreshold);
+    }
+
+    if (isActive != wasActive)
+    {
+        LOG_INFO(
+            "Disk activity {} KiB/s, {} op/s, {} threshold ({} disks)",
+            static_cast<unsigned long long>(bytesRate),
+            static_cast<unsigned long long>(opsRate),
+            isActive ? "above" : "below",
+            mMonitor.GetDiskCount()
+        );
+    }
+
+    return isActive;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "CpuScanner"
+
+auto CpuScanner::Invalidate () -> void
+{
+    // Called from window thread, handled on next scan.
+    mInvalidated = true;
+    mHealth.Invalidate();
+}
+
+auto CpuScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_CPU)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerCpu;
+    if (trigger.Threshold == 0)
+    {
+        return false;
+    }
+
+    // Counters keep running during sleep, don't count it as idle time.
+    if (mInvalidated.exchange(false))
+    {
+        mHasLast = false;
+    }
+
+    if (!mHealth.CanRun())
+    {
+        return mThreshold.IsActive();
+    }
+
+    auto idleTime   = FILETIME{};
+    auto kernelTime = FILETIME{};
+    auto userTime   = FILETIME{};
+    if (!GetSystemTimes(&idleTime, &kernelTime, &userTime))
+    {
+        mHealth.OnFailure("can't read system times");
+        return mThreshold.IsActive();
+    }
+
+    mHealth.OnSuccess();
+
+    const auto toValue = [](const FILETIME& ft) {
+        return (static_cast<unsigned long long>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    };
+
+    // Kernel time includes idle time.
+    const auto idle  = toValue(idleTime);
+    const auto total = toValue(kernelTime) + toValue(userTime);
+
+    const auto hadLast    = mHasLast;
+    const auto idleDelta  = idle  - mLastIdle;
+    const auto totalDelta = total - mLastTotal;
+
+    mLastIdle  = idle;
+    mLastTotal = total;
+    mHasLast   = true;
+
+    if (!hadLast || totalDelta == 0 || idleDelta > totalDelta)
+    {
+        return mThreshold.IsActive();
+    }
+
+    const auto sample    = 100.0 * static_cast<double>(totalDelta - idleDelta) / static_cast<double>(totalDelta);
+    const auto usage     = mUsage.Add(ExponentialAverage::Clock::now(), sample, std::chrono::milliseconds(trigger.Window));
+    const auto wasActive = mThreshold.IsActive();
+    const auto isActive  = mThreshold.Update(usage, trigger.Threshold, trigger.OffThreshold);
+
+    if (isActive != wasActive)
+    {
+        LOG_INFO("CPU usage {}%, {} threshold", static_cast<unsigned int>(usage), isActive ? "above" : "below");
+    }
+
+    return isActive;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "TcpScanner"
+
+auto TcpScanner::Invalidate () -> void
+{
+    mHealth.Invalidate();
+}
+
+auto TcpScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerTcp;
+
+    mMonitor.SetRules(trigger.Ports, trigger.Listeners);
+    if (!mMonitor.HasRules() || !mHealth.CanRun())
+    {
+        return false;
+    }
+
+    auto ok    = true;
+    const auto found = mMonitor.Find(ok);
+    if (!ok)
+    {
+        mHealth.OnFailure("can't read TCP connection table");
+        return false;
+    }
+
+    mHealth.OnSuccess();
+
+    const auto port = found ? mMonitor.GetLastPort() : static_cast<unsigned short>(0);
+    if (port != mLastFoundPort)
+    {
+        if (found)
+        {
+            LOG_INFO("Found established TCP connection on port {}", port);
+        }
+
+        mLastFoundPort = port;
+    }
+
+    return found;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "DirectoryScanner"
+
+auto DirectoryScanner::OnDirectoryChange () -> void
+{
+    const auto now      = Clock::now().time_since_epoch().count();
+    const auto previous = mLastChange.exchange(now);
+
+    // Wake scanner only on first change after quiet period, writes during
+    // activity just move the deadline.
+    if (mOnChange && (previous == 0 || now - previous >= mActiveTimeout))
+    {
+        mOnChange();
+    }
+}
+
+auto DirectoryScanner::StartMonitoring (SettingsPtr settings, ChangeFn onChange) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    return false;
+#else
+    StopMonitoring();
+
+    const auto& trigger = settings->Auto.TriggerDirectory;
+
+    mDirectories   = trigger.Directories;
+    mActiveTimeout = std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(trigger.ActiveTimeout)).count();
+    mOnChange      = onChange;
+    mRetryTime     = Clock::now() + RetryInterval;
+    mIsStarted     = true;
+    mIsMonitoring  = mSource->Start(mDirectories, [this]{ OnDirectoryChange(); });
+
+    return mIsMonitoring;
+#endif
+}
+
+auto DirectoryScanner::StopMonitoring () -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    if (mSource)
+    {
+        mSource->Stop();
+    }
+
+    mOnChange     = nullptr;
+    mIsStarted    = false;
+    mIsMonitoring = false;
+    mLastChange   = 0;
+    mWasActive    = false;
+#endif
+}
+
+auto DirectoryScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_DIRECTORY)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerDirectory;
+
+    // Settings changed while running, watch new directories.
+    if (mIsStarted && trigger.Directories != mDirectories)
+    {
+        StartMonitoring(settings, mOnChange);
+    }
+
+    if (mIsMonitoring && !mSource->IsRunning())
+    {
+        LOG_WARNING("Lost all watched directories, retrying every {} s", RetryInterval.count());
+        mIsMonitoring = false;
+    }
+
+    // Directories missing at start or deleted later are reopened once
+    // they exist again, checked only every few seconds.
+    const auto now = Clock::now();
+    if (mIsStarted && now >= mRetryTime)
+    {
+        mRetryTime = now + RetryInterval;
+        if (mSource->Retry())
+        {
+            mIsMonitoring = mSource->IsRunning();
+        }
+    }
+
+    mActiveTimeout = std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(trigger.ActiveTimeout)).count();
+
+    const auto lastChange = mLastChange.load();
+    const auto isActive   = lastChange != 0 && Clock::now().time_since_epoch().count() - lastChange < mActiveTimeout;
+
+    if (isActive != mWasActive)
+    {
+        if (isActive)
+        {
+            LOG_INFO("Detected activity in watched directories");
+        }
+        else
+        {
+            LOG_INFO("No activity in watched directories for {} s", trigger.ActiveTimeout / 1000);
+        }
+
+        mWasActive = isActive;
+    }
+
+    return isActive;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "RemoteSessionScanner"
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+namespace {
+    auto QuerySessionString (DWORD sessionId, WTS_INFO_CLASS infoClass) -> std::wstring
+    {
+        auto buffer = LPWSTR{NULL};
+        auto size   = DWORD{0};
+        if (!WTSQuerySessionInformationW(WTS_CURRENT_SERVER_HANDLE, sessionId, infoClass, &buffer, &size))
+        {
+            return L"";
+        }
+
+        auto str = std::wstring(buffer);
+        WTSFreeMemory(buffer);
+
+        return str;
+    }
+
+    auto QueryClientProtocol (DWORD sessionId) -> USHORT
+    {
+        auto buffer = LPWSTR{NULL};
+        auto size   = DWORD{0};
+        if (!WTSQuerySessionInformationW(WTS_CURRENT_SERVER_HANDLE, sessionId, WTSClientProtocolType, &buffer, &size))
+        {
+            return WTS_PROTOCOL_TYPE_CONSOLE;
+        }
+
+        const auto protocol = *reinterpret_cast<USHORT*>(buffer);
+        WTSFreeMemory(buffer);
+
+        return protocol;
+    }
+
+    auto QueryClientAddress (DWORD sessionId) -> std::wstring
+    {
+        auto buffer = LPWSTR{NULL};
+        auto size   = DWORD{0};
+        if (!WTSQuerySessionInformationW(WTS_CURRENT_SERVER_HANDLE, sessionId, WTSClientAddress, &buffer, &size))
+        {
+            return L"";
+        }
+
+        auto str = std::wstring();
+
+        const auto address = reinterpret_cast<const WTS_CLIENT_ADDRESS*>(buffer);
+        if (address->AddressFamily == AF_INET)
+        {
+            str = std::format(
+                L"{}.{}.{}.{}", address->Address[2], address->Address[3], address->Address[4], address->Address[5]
+            );
+        }
+
+        WTSFreeMemory(buffer);
+
+        return str;
+    }
+
+    auto ContainsIgnoreCase (const std::vector<std::wstring>& list, const std::wstring& value) -> bool
+    {
+        return std::any_of(
+            list.begin(), list.end(), [&](const std::wstring& item) { return _wcsicmp(item.c_str(), value.c_str()) == 0; }
+        );
+    }
+}
+#endif
+
+auto RemoteSessionScanner::Invalidate () -> void
+{
+    mSessionsChanged = true;
+    mHealth.Invalidate();
+}
+
+auto RemoteSessionScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_REMOTE_SESSION)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerRemoteSession;
+
+    auto changed = mSessionsChanged.exchange(false);
+    if (trigger.Users != mLastUsers || trigger.Hosts != mLastHosts)
+    {
+        mLastUsers = trigger.Users;
+        mLastHosts = trigger.Hosts;
+        changed    = true;
+    }
+
+    if (!changed)
+    {
+        return mLastFound;
+    }
+
+    if (!mHealth.CanRun())
+    {
+        mSessionsChanged = true;
+        return mLastFound;
+    }
+
+    auto sessions = PWTS_SESSION_INFOW{NULL};
+    auto count    = DWORD{0};
+    if (!WTSEnumerateSessionsW(WTS_CURRENT_SERVER_HANDLE, 0, 1, &sessions, &count))
+    {
+        mHealth.OnFailure("can't enumerate sessions");
+        mSessionsChanged = true;
+        return mLastFound;
+    }
+
+    mHealth.OnSuccess();
+
+    auto found = false;
+    for (auto i = DWORD{0}; i < count && !found; ++i)
+    {
+        const auto sessionId = sessions[i].SessionId;
+        if (sessions[i].State != WTSActive || QueryClientProtocol(sessionId) != WTS_PROTOCOL_TYPE_RDP)
+        {
+            continue;
+        }
+
+        const auto user = QuerySessionString(sessionId, WTSUserName);
+        if (user.empty())
+        {
+            continue;
+        }
+
+        if (!trigger.Users.empty() && !ContainsIgnoreCase(trigger.Users, user))
+        {
+            continue;
+        }
+
+        const auto host    = QuerySessionString(sessionId, WTSClientName);
+        const auto address = QueryClientAddress(sessionId);
+        if (!trigger.Hosts.empty() && !ContainsIgnoreCase(trigger.Hosts, host) && !ContainsIgnoreCase(trigger.Hosts, address))
+        {
+            continue;
+        }
+
+        LOG_INFO(L"Found remote session of '{}' from '{}' ({})", user, host, address);
+        found = true;
+    }
+
+    WTSFreeMemory(sessions);
+
+    if (!found && mLastFound)
+    {
+        LOG_INFO("No matching remote session");
+    }
+
+    mLastFound = found;
+
+    return found;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "JobScanner"
+
+auto JobScanner::Invalidate () -> void
+{
+    // Called from window thread, handled on next scan.
+    mInvalidated = true;
+}
+
+auto JobScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_JOB)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerJob;
+
+    if (mInvalidated.exchange(false))
+    {
+        mSource->Invalidate();
+        mSamples.clear();
+    }
+
+    if (mProcessorCount == 0)
+    {
+        mProcessorCount = std::max(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), DWORD{1});
+    }
+
+    const auto now = Clock::now();
+
+    // Every job is queried even after match, so CPU samples stay fresh.
+    auto found = std::wstring();
+    for (const auto& name : trigger.Jobs)
+    {
+        auto accounting = JobAccounting();
+        if (!mSource->Query(name, accounting))
+        {
+            mSamples.erase(name);
+            continue;
+        }
+
+        // Job times are in 100ns units.
+        using Ticks100ns = std::chrono::duration<long long, std::ratio<1, 10000000>>;
+
+        auto& sample       = mSamples[name];
+        const auto had     = sample.Time != Clock::time_point();
+        const auto cpu     = accounting.CpuTime - std::min(sample.CpuTime, accounting.CpuTime);
+        const auto elapsed = std::chrono::duration_cast<Ticks100ns>(now - sample.Time).count();
+
+        sample.CpuTime = accounting.CpuTime;
+        sample.Time    = now;
+
+        if (!found.empty() || accounting.ActiveProcesses == 0)
+        {
+            continue;
+        }
+
+        if (trigger.CpuThreshold == 0)
+        {
+            found = name;
+            continue;
+        }
+
+        if (had && elapsed > 0)
+        {
+            const auto usage = 100.0 * static_cast<double>(cpu) / (static_cast<double>(elapsed) * mProcessorCount);
+            if (usage >= trigger.CpuThreshold)
+            {
+                found = name;
+            }
+        }
+    }
+
+    if (found != mLastFoundJob)
+    {
+        if (!found.empty())
+        {
+            LOG_INFO(L"Found active job '{}'", found);
+        }
+
+        mLastFoundJob = found;
+    }
+
+    return !found.empty();
+#endif
+}
+
+#pragma endregion
+
+#pragma region "PidFileScanner"
+
+PidFileScanner::~PidFileScanner ()
+{
+    for (auto& [path, entry] : mEntries)
+    {
+        CloseEntry(entry);
+    }
+}
+
+auto PidFileScanner::Invalidate () -> void
+{
+    // Called from window thread, handled on next scan.
+    mInvalidated = true;
+}
+
+auto PidFileScanner::CloseEntry (Entry& entry) -> void
+{
+    if (entry.Process)
+    {
+        CloseHandle(entry.Process);
+    }
+
+    entry = Entry();
+}
+
+auto PidFileScanner::ReadEntry (const std::wstring& path, Entry& entry) -> void
+{
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE)
+    const auto file = CreateFileW(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL
+    );
+
+    // Might be locked by writer, retried on next scan.
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        if (!entry.IsWarned)
+        {
+            LOG_WARNING(L"Can't open pidfile '{}', error {}", path, GetLastError());
+            entry.IsWarned = true;
+        }
+
+        return;
+    }
+
+    // Pid is at the beginning, no need to read more.
+    auto buffer = std::array<char, 32>();
+    auto read   = DWORD{0};
+    const auto result = ReadFile(file, buffer.data(), static_cast<DWORD>(buffer.size()), &read, NULL);
+    const auto error  = GetLastError();
+
+    CloseHandle(file);
+
+    if (!result)
+    {
+        if (!entry.IsWarned)
+        {
+            LOG_WARNING(L"Can't read pidfile '{}', error {}", path, error);
+            entry.IsWarned = true;
+        }
+
+        return;
+    }
+
+    entry.IsRead = true;
+
+    auto i = DWORD{0};
+    while (i < read && (buffer[i] == ' ' || buffer[i] == '\t'))
+    {
+        ++i;
+    }
+
+    auto pid    = 0ull;
+    auto digits = 0;
+    while (i < read && '0' <= buffer[i] && buffer[i] <= '9' && digits < 10)
+    {
+        pid = pid * 10 + (buffer[i] - '0');
+        ++i;
+        ++digits;
+    }
+
+    // Garbage or stale content, file alone doesn't keep system awake.
+    if (digits == 0 || pid == 0 || pid > MAXDWORD)
+    {
+        if (!entry.IsWarned)
+        {
+            LOG_WARNING(L"Pidfile '{}' doesn't contain pid, ignored until rewritten", path);
+            entry.IsWarned = true;
+        }
+
+        return;
+    }
+
+    entry.HasPid  = true;
+    entry.Pid     = static_cast<DWORD>(pid);
+    entry.Process = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, entry.Pid);
+
+    // Process started after pidfile was written has reused the pid.
+    if (entry.Process)
+    {
+        auto creationTime = FILETIME{};
+        auto exitTime     = FILETIME{};
+        auto kernelTime   = FILETIME{};
+        auto userTime     = FILETIME{};
+        if (GetProcessTimes(entry.Process, &creationTime, &exitTime, &kernelTime, &userTime)
+            && CompareFileTime(&creationTime, &entry.WriteTime) > 0)
+        {
+            LOG_DEBUG(L"Process {} from '{}' was started after pidfile was written", entry.Pid, path);
+            CloseHandle(entry.Process);
+            entry.Process = NULL;
+        }
+    }
+#endif
+}
+
+auto PidFileScanner::IsAlive (const std::wstring& path, Entry& entry, bool lockFile) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE)
+    return false;
+#else
+    auto attributes = WIN32_FILE_ATTRIBUTE_DATA{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes)
+        || (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        CloseEntry(entry);
+        return false;
+    }
+
+    // Only existence matters, content isn't read.
+    if (lockFile)
+    {
+        return true;
+    }
+
+    const auto size = (static_cast<unsigned long long>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+
+    // Rewritten, read pid again.
+    if (size != entry.Size || CompareFileTime(&attributes.ftLastWriteTime, &entry.WriteTime) != 0)
+    {
+        CloseEntry(entry);
+
+        entry.Size      = size;
+        entry.WriteTime = attributes.ftLastWriteTime;
+
+        ReadEntry(path, entry);
+    }
+    else if (!entry.IsRead)
+    {
+        ReadEntry(path, entry);
+    }
+
+    if (!entry.HasPid)
+    {
+        return false;
+    }
+
+    return entry.Process && WaitForSingleObject(entry.Process, 0) == WAIT_TIMEOUT;
+#endif
+}
+
+auto PidFileScanner::Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_PIDFILE)
+    return false;
+#else
+    const auto& trigger = settings->Auto.TriggerPidFile;
+
+    if (mInvalidated.exchange(false))
+    {
+        for (auto& [path, entry] : mEntries)
+        {
+            CloseEntry(entry);
+        }
+    }
+
+    // Forget files removed from settings.
+    if (mEntries.size() > trigger.Files.size())
+    {
+        std::erase_if(
+            mEntries,
+            [&](auto& item)
+            {
+                if (std::find(trigger.Files.begin(), trigger.Files.end(), item.first) != trigger.Files.end())
+                {
+                    return false;
+                }
+
+                CloseEntry(item.second);
+                return true;
+            }
+        );
+    }
+
+    auto found = std::wstring();
+    for (const auto& path : trigger.Files)
+    {
+        if (IsAlive(path, mEntries[path], trigger.LockFiles))
+        {
+            found = path;
+            break;
+        }
+    }
+
+    if (found != mLastFoundFile)
+    {
+        if (!found.empty())
+        {
+            LOG_INFO(L"Found pidfile '{}'", found);
+        }
+
+        mLastFoundFile = found;
+    }
+
+    return !found.empty();
+#endif
+}
+
+#pragma endregion
+
 } // namespace CaffeineTake
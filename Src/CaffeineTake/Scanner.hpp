@@ -20,15 +20,31 @@
 
 #pragma once
 
+#include "ActivityMeter.hpp"
 #include "BluetoothIdentifier.hpp"
+#include "BluetoothRadio.hpp"
+#include "DirectoryWatcher.hpp"
+#include "DiskMonitor.hpp"
 #include "ForwardDeclaration.hpp"
+#include "JobSource.hpp"
+#include "NetworkMonitor.hpp"
+#include "ScannerHealth.hpp"
+#include "TcpMonitor.hpp"
 #include "ThreadTimer.hpp"
+#include "UsbDeviceSource.hpp"
 #include "Utility.hpp"
+#include "WindowTracker.hpp"
 
+#include <atomic>
 #include <chrono>
-#include <map>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -40,12 +56,92 @@ namespace {
 
 namespace CaffeineTake {
 
+struct ScanStats
+{
+    unsigned long long       Ticks       = 0;
+    unsigned long long       Revalidated = 0;  // previous hit still valid
+    unsigned long long       Gated       = 0;  // nothing changed, previous result reused
+    unsigned long long       FullScans   = 0;
+    unsigned long long       Hits        = 0;
+    std::chrono::nanoseconds ProbeTime   = std::chrono::nanoseconds(0);  // revalidation and change probes
+    std::chrono::nanoseconds ScanTime    = std::chrono::nanoseconds(0);  // full scans
+};
+
 class Scanner
 {
+    using Clock = std::chrono::steady_clock;
+
+    bool               mHasResult    = false;
+    bool               mLastResult   = false;
+    Clock::time_point  mLastFullScan = Clock::time_point();
+    Clock::time_point  mLastStatsLog = Clock::now();
+    ScanStats          mStats        = ScanStats();
+    ExponentialAverage mCost         = ExponentialAverage();  // in us, per tick
+    ExponentialAverage mHitRate      = ExponentialAverage();
+
+    auto UpdateEstimate (Clock::time_point start, bool result) -> bool;
+
+protected:
+    // Change probe might miss something, full scan is forced after this time.
+    static constexpr auto MaxGatedTime = std::chrono::seconds(30);
+
+    // Time constant of cost and hit rate averages.
+    static constexpr auto EstimateTime = std::chrono::minutes(10);
+
 public:
     virtual ~Scanner() {}
 
+    virtual auto GetName () const -> std::string_view = 0;
+
     virtual auto Run (SettingsPtr, const StopToken&, const PauseToken&) -> bool = 0;
+
+    // Cheap check if trigger found by previous Run() is still there, e.g.
+    // process handle not signaled, window handle still valid, device still
+    // present. Returns false if there was no previous hit.
+    virtual auto RevalidateLastHit (SettingsPtr) -> bool
+    {
+        return false;
+    }
+
+    // Cheap check if anything scanner looks at changed since the last call,
+    // e.g. process list hash, tracker generation. Returns true if unsure.
+    virtual auto HasChanged (SettingsPtr) -> bool
+    {
+        return true;
+    }
+
+    // Called on device change and resume from sleep, cached capabilities
+    // and failure backoff should be reset.
+    virtual auto Invalidate () -> void {}
+
+    // While previous hit is valid tick costs single lookup. When there was
+    // no hit and nothing changed previous result is reused. Full scan is
+    // done only otherwise.
+    auto Scan (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool;
+
+    auto GetStats () const -> const ScanStats&
+    {
+        return mStats;
+    }
+
+    // Mean tick cost in microseconds and probability that tick finds
+    // trigger, valid only after first tick. Used to order scanners.
+    auto HasEstimate () const -> bool
+    {
+        return mStats.Ticks > 0;
+    }
+
+    auto GetMeanCost () const -> double
+    {
+        return mCost.GetValue();
+    }
+
+    auto GetHitRate () const -> double
+    {
+        return mHitRate.GetValue();
+    }
+
+    auto LogStats () const -> void;
 };
 
 class ProcessScanner : public Scanner
@@ -53,58 +149,413 @@ class ProcessScanner : public Scanner
     std::wstring mLastProcessName = L"";
     std::wstring mLastProcessPath = L"";
     DWORD        mLastPid         = 0;
+    FILETIME     mLastStartTime   = FILETIME();  // tells apart process that reused the pid
+    HANDLE       mLastProcess     = NULL;  // SYNCHRONIZE access, signaled when process exits
+
+    std::vector<DWORD>        mPidBuffer         = std::vector<DWORD>(1024);
+    unsigned long long        mPidHash           = 0;
+    std::vector<std::wstring> mWatchedProcesses  = std::vector<std::wstring>();
 
-    auto CheckLast () -> bool;
+    auto CheckLast   () -> bool;
+    auto IsLastAlive () -> bool;
+    auto ResetLast   () -> void;
 
 public:
-    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+    ~ProcessScanner ()
+    {
+        ResetLast();
+    }
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Process";
+    }
+
+    // Hash of running process ids, PIDs are listed without opening
+    // processes and reading image paths.
+    auto HasChanged        (SettingsPtr settings) -> bool override;
+    auto RevalidateLastHit (SettingsPtr settings) -> bool override;
+    auto Run               (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
 };
 
 class WindowScanner : public Scanner
 {
+    using ChangeFn = std::function<void ()>;
+
+    WindowTracker                    mTracker;
+    ChangeFn                         mOnChange        = nullptr;
+    std::mutex                       mWatchedMutex;
+    std::vector<std::wstring>        mWatchedList     = std::vector<std::wstring>();
+    std::unordered_set<std::wstring> mWatchedSet      = std::unordered_set<std::wstring>();
+    std::wstring                     mLastFoundWindow = L"";
+    HWND                             mLastFoundHwnd   = NULL;   // only without tracker
+    unsigned long long               mLastGeneration  = 0;
+    std::vector<std::wstring>        mLastWindows     = std::vector<std::wstring>();
+
+    auto UpdateWatched (const std::vector<std::wstring>& windows) -> void;
+
+public:
+    // When tracking is running Run() only does lookups in window index,
+    // onChange is called when window with watched title appears or disappears.
+    auto StartTracking (SettingsPtr settings, ChangeFn onChange) -> bool;
+    auto StopTracking  () -> void;
+
+    auto IsTracking () const -> bool
+    {
+        return mTracker.IsRunning();
+    }
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Window";
+    }
+
+    // Tracker generation, without tracker there is no cheap probe.
+    auto HasChanged        (SettingsPtr settings) -> bool override;
+    auto RevalidateLastHit (SettingsPtr settings) -> bool override;
+    auto Run               (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+class FullscreenScanner : public Scanner
+{
+    using ChangeFn = std::function<void ()>;
+
+    ForegroundTracker mTracker;
+    HWND              mLastWindow     = NULL;
+    bool              mLastIsIgnored  = false;
+    bool              mLastResult     = false;
+
+    auto IsIgnored (SettingsPtr settings, HWND hWnd) -> bool;
+
 public:
+    // When tracking is running Run() only reads cached foreground state,
+    // onChange is called when foreground window enters or leaves fullscreen.
+    auto StartTracking (ChangeFn onChange) -> bool;
+    auto StopTracking  () -> void;
+
+    auto IsTracking () const -> bool
+    {
+        return mTracker.IsRunning();
+    }
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Fullscreen";
+    }
+
     auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
 };
 
 class UsbDeviceScanner : public Scanner
 {
-    std::wstring mLastFoundDevice = L"";
+    using ChangeFn = std::function<void ()>;
+
+    std::unique_ptr<UsbDeviceSource>                    mSource;
+    UsbHotplugMonitor                                   mHotplug;
+    UsbDeviceIndex                                      mIndex           = UsbDeviceIndex();
+    ScannerHealth                                       mHealth          = ScannerHealth("USB device scan");
+    std::unordered_map<unsigned long long, UsbClassSet> mClassCache      = std::unordered_map<unsigned long long, UsbClassSet>(); // instance id hash -> classes
+    std::wstring                                        mLastFoundDevice = L"";
+    unsigned long long                                  mLastGeneration  = 0;
+    std::atomic<bool>                                   mDevicesChanged  = true;  // set on device change notification
+
+    auto GetClasses (std::wstring_view instanceId, unsigned long long instanceIdHash) -> UsbClassSet;
 
 public:
-    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+    UsbDeviceScanner (std::unique_ptr<UsbDeviceSource> source = std::make_unique<ConfigManagerUsbDeviceSource>())
+        : mSource (std::move(source))
+    {
+    }
+
+    // When monitoring is running Run() only does lookups in present device
+    // set, onChange is called when device is connected or disconnected.
+    auto StartMonitoring (ChangeFn onChange) -> bool;
+    auto StopMonitoring  () -> void;
+
+    auto IsMonitoring () const -> bool
+    {
+        return mHotplug.IsRunning();
+    }
+
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "USB";
+    }
+
+    // Hotplug generation or device change notification.
+    auto HasChanged        (SettingsPtr settings) -> bool override;
+    auto RevalidateLastHit (SettingsPtr settings) -> bool override;
+    auto Run               (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
 };
 
+// Inquiry and device enumeration run on background thread, Run() only
+// reads cached last seen table.
 class BluetoothScanner : public Scanner
 {
-    using LocalTime   = std::chrono::local_time<std::chrono::system_clock::duration>;
-    using LastSeenMap = std::map<unsigned long long, LocalTime>;
+    struct CachedDevice
+    {
+        std::wstring    Name        = L"";
+        bool            IsConnected = false;
+        SystemTimePoint LastSeen    = SystemTimePoint();
+    };
+
+    using DeviceMap = std::unordered_map<unsigned long long, CachedDevice>;
 
-    BluetoothIdentifier  mLastFoundDevice  = BluetoothIdentifier();
-    HMODULE              mLibBluetoothApis = NULL;
-    LastSeenMap          mLastSeenMap      = LastSeenMap();
-    LocalTime            mLastInquiryTime  = LocalTime();
-    std::chrono::seconds mInquiryTimeout   = std::chrono::seconds(60);
+    std::unique_ptr<BluetoothRadio>  mRadio;
+    std::mutex                       mCacheMutex;
+    DeviceMap                        mDevices          = DeviceMap();                          // trigger devices seen by radio
+    std::vector<BluetoothIdentifier> mTriggerDevices   = std::vector<BluetoothIdentifier>();
+    std::atomic<bool>                mIsRadioPresent   = false;
+    std::atomic<long long>           mActiveTimeoutMs  = 0;
+    SystemTimePoint                  mLastInquiryTime  = SystemTimePoint();                    // worker only
+    std::chrono::seconds             mInquiryTimeout   = std::chrono::seconds(60);
+    BluetoothIdentifier              mLastFoundDevice  = BluetoothIdentifier();
+    ScannerHealth                    mHealth           = ScannerHealth("Bluetooth scan");  // worker only
+    ThreadTimer                      mInquiryTimer;
 
-    auto SystemTimeToChronoLocalTimePoint (const SYSTEMTIME& st);
+    auto ShouldPerformDeviceInquiry (const SystemTimePoint& now, const std::chrono::seconds deviceActiveTimeout) -> bool;
+    auto Refresh                    (const StopToken& stop) -> void;
 
-    auto ShouldPerformDeviceInquiry   (const LocalTime& localTime, const std::chrono::seconds deviceActiveTimeout) -> bool;
-    auto IssueDeviceInquiry           () -> bool;
-    auto CheckIfThereIsBluetoothRadio () -> bool;
+public:
+    BluetoothScanner (std::unique_ptr<BluetoothRadio> radio = std::make_unique<WindowsBluetoothRadio>());
 
-    auto EnumerateBluetoothDevices (
-        SettingsPtr                settings,
-        const LocalTime&           localTime,
-        const std::chrono::seconds deviceActiveTimeout,
-        const StopToken&           stop
-    ) -> BluetoothIdentifier;
+    auto StopInquiry () -> void;
+
+    auto IsInquiryRunning () -> bool
+    {
+        return mInquiryTimer.IsRunning();
+    }
+
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Bluetooth";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while network throughput of selected interfaces averaged over
+// window is above threshold.
+class NetworkScanner : public Scanner
+{
+    NetworkMonitor      mMonitor;
+    RateWindow          mRate      = RateWindow();
+    HysteresisThreshold mThreshold = HysteresisThreshold();
+    ScannerHealth       mHealth    = ScannerHealth("Network scan");
 
 public:
-    ~BluetoothScanner ()
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Network";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while disk throughput or operation rate of selected disks averaged
+// over window is above threshold.
+class DiskScanner : public Scanner
+{
+    DiskMonitor         mMonitor;
+    RateWindow          mBytesRate      = RateWindow();
+    RateWindow          mOpsRate        = RateWindow();
+    HysteresisThreshold mBytesThreshold = HysteresisThreshold();
+    HysteresisThreshold mOpsThreshold   = HysteresisThreshold();
+    ScannerHealth       mHealth         = ScannerHealth("Disk scan");
+
+public:
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Disk";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while smoothed system-wide CPU usage is above threshold.
+class CpuScanner : public Scanner
+{
+    unsigned long long  mLastIdle    = 0;
+    unsigned long long  mLastTotal   = 0;
+    bool                mHasLast     = false;
+    ExponentialAverage  mUsage       = ExponentialAverage();
+    HysteresisThreshold mThreshold   = HysteresisThreshold();
+    ScannerHealth       mHealth      = ScannerHealth("CPU scan");
+    std::atomic<bool>   mInvalidated = false;
+
+public:
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "CPU";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while there is established TCP connection on selected port.
+class TcpScanner : public Scanner
+{
+    TcpMonitor     mMonitor;
+    unsigned short mLastFoundPort = 0;
+    ScannerHealth  mHealth        = ScannerHealth("TCP scan");
+
+public:
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "TCP";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while there were changes in watched directories within timeout.
+class DirectoryScanner : public Scanner
+{
+public:
+    using ChangeFn = std::function<void ()>;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr auto RetryInterval = std::chrono::seconds(10);
+
+    std::unique_ptr<DirectoryChangeSource> mSource        = std::make_unique<WindowsDirectoryChangeSource>();
+    std::vector<std::wstring>              mDirectories   = std::vector<std::wstring>();
+    ChangeFn                               mOnChange      = nullptr;
+    std::atomic<Clock::rep>                mLastChange    = 0;
+    std::atomic<Clock::rep>                mActiveTimeout = 0;
+    Clock::time_point                      mRetryTime     = Clock::time_point();  // next check for missing directories
+    bool                                   mIsStarted     = false;  // monitoring requested, even if it failed
+    bool                                   mIsMonitoring  = false;
+    bool                                   mWasActive     = false;
+
+    auto OnDirectoryChange () -> void;
+
+public:
+    auto SetSource (std::unique_ptr<DirectoryChangeSource> source) -> void
+    {
+        StopMonitoring();
+        mSource = std::move(source);
+    }
+
+    auto StartMonitoring (SettingsPtr settings, ChangeFn onChange) -> bool;
+    auto StopMonitoring  () -> void;
+
+    auto IsStarted () const -> bool
+    {
+        return mIsStarted;
+    }
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Directory";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while remote desktop session of matching user or client host is
+// logged on. Sessions are enumerated only after session change
+// notification or rule change, otherwise last result is returned.
+class RemoteSessionScanner : public Scanner
+{
+    std::atomic<bool>         mSessionsChanged = true;
+    std::vector<std::wstring> mLastUsers       = std::vector<std::wstring>();
+    std::vector<std::wstring> mLastHosts       = std::vector<std::wstring>();
+    bool                      mLastFound       = false;
+    ScannerHealth             mHealth          = ScannerHealth("Remote session scan");
+
+public:
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "RemoteSession";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while any selected job object has running processes, optionally
+// only while they use more CPU than threshold.
+class JobScanner : public Scanner
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Sample
+    {
+        unsigned long long CpuTime = 0;
+        Clock::time_point  Time    = Clock::time_point();
+    };
+
+    std::unique_ptr<JobSource>               mSource         = std::make_unique<WindowsJobSource>();
+    std::unordered_map<std::wstring, Sample> mSamples        = std::unordered_map<std::wstring, Sample>();
+    std::wstring                             mLastFoundJob   = L"";
+    DWORD                                    mProcessorCount = 0;
+    std::atomic<bool>                        mInvalidated    = false;
+
+public:
+    auto SetSource (std::unique_ptr<JobSource> source) -> void
+    {
+        mSource = std::move(source);
+        mSamples.clear();
+    }
+
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
+    {
+        return "Job";
+    }
+
+    auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
+};
+
+// Active while listed pidfile exists and process it names is running. File
+// is read only when its size or write time changes, process is then kept
+// open, so checking rule is one attribute query and one handle wait. Files
+// without pid (lock files) are active while they exist.
+class PidFileScanner : public Scanner
+{
+    struct Entry
+    {
+        FILETIME           WriteTime = FILETIME();
+        unsigned long long Size      = 0;
+        bool               IsRead    = false;  // false while file can't be opened, retried every scan
+        bool               IsWarned  = false;  // unreadable or invalid content reported
+        bool               HasPid    = false;
+        DWORD              Pid       = 0;
+        HANDLE             Process   = NULL;
+    };
+
+    std::unordered_map<std::wstring, Entry> mEntries       = std::unordered_map<std::wstring, Entry>();
+    std::wstring                            mLastFoundFile = L"";
+    std::atomic<bool>                       mInvalidated   = false;
+
+    auto CloseEntry (Entry& entry) -> void;
+    auto ReadEntry  (const std::wstring& path, Entry& entry) -> void;
+    auto IsAlive    (const std::wstring& path, Entry& entry, bool lockFile) -> bool;
+
+public:
+    ~PidFileScanner ();
+
+    auto Invalidate () -> void override;
+
+    auto GetName () const -> std::string_view override
     {
-        if (mLibBluetoothApis)
-        {
-            FreeLibrary(mLibBluetoothApis);
-        }
+        return "PidFile";
     }
 
     auto Run (SettingsPtr settings, const StopToken& stop, const PauseToken& pause) -> bool override;
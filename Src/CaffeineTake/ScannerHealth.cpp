@@ -0,0 +1,101 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "ScannerHealth.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace CaffeineTake {
+
+auto ScannerHealth::CheckInvalidated () -> void
+{
+    if (mIsInvalidated.exchange(false))
+    {
+        LOG_DEBUG("{} scanner state invalidated", mName);
+
+        mFailures          = 0;
+        mRetryTime         = Clock::time_point();
+        mIsCapabilityValid = false;
+    }
+}
+
+auto ScannerHealth::CanRun () -> bool
+{
+    CheckInvalidated();
+
+    return mFailures == 0 || Clock::now() >= mRetryTime;
+}
+
+auto ScannerHealth::OnSuccess () -> void
+{
+    if (mFailures > 0)
+    {
+        LOG_INFO("{} recovered after {} failures", mName, mFailures);
+        mFailures = 0;
+    }
+}
+
+auto ScannerHealth::OnFailure (std::string_view reason) -> void
+{
+    mFailures += 1;
+
+    // Capability might be gone, e.g. radio was removed.
+    mIsCapabilityValid = false;
+
+    const auto shift   = std::min(mFailures - 1, 16u);
+    const auto backoff = std::min(mMinBackoff * (1u << shift), mMaxBackoff);
+    mRetryTime = Clock::now() + backoff;
+
+    if (std::has_single_bit(mFailures))
+    {
+        LOG_WARNING(
+            "{} failed: {} ({} times in a row, next try in {}s)",
+            mName, reason, mFailures, std::chrono::duration_cast<std::chrono::seconds>(backoff).count()
+        );
+    }
+}
+
+auto ScannerHealth::GetCapability (const ProbeFn& probe) -> bool
+{
+    CheckInvalidated();
+
+    const auto now = Clock::now();
+    if (!mIsCapabilityValid || now - mCapabilityTime >= mCapabilityTimeout)
+    {
+        const auto capability = probe();
+        if (mCapability != capability)
+        {
+            LOG_INFO("{} capability changed: {}", mName, capability ? "available" : "not available");
+        }
+
+        mCapability        = capability;
+        mCapabilityTime    = now;
+        mIsCapabilityValid = true;
+    }
+
+    return mCapability.value();
+}
+
+} // namespace CaffeineTake
@@ -0,0 +1,96 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace CaffeineTake {
+
+// Keeps scanner from hammering broken subsystem. After repeated failures
+// scanner is skipped for exponentially growing time and failures are
+// logged only on 1st, 2nd, 4th, 8th... occurrence. Capability probes
+// (e.g. is there Bluetooth radio) are cached until invalidated by device
+// change or resume from sleep.
+//
+// Used from single scanner thread, only Invalidate() is thread safe.
+class ScannerHealth
+{
+public:
+    using Clock    = std::chrono::steady_clock;
+    using Duration = Clock::duration;
+    using ProbeFn  = std::function<bool ()>;
+
+private:
+    std::string         mName;
+    Duration            mMinBackoff;
+    Duration            mMaxBackoff;
+    Duration            mCapabilityTimeout;
+    unsigned int        mFailures          = 0;
+    Clock::time_point   mRetryTime         = Clock::time_point();
+    std::optional<bool> mCapability        = std::nullopt;
+    Clock::time_point   mCapabilityTime    = Clock::time_point();
+    bool                mIsCapabilityValid = false;
+    std::atomic<bool>   mIsInvalidated     = false;
+
+    auto CheckInvalidated () -> void;
+
+public:
+    ScannerHealth (
+        std::string name,
+        Duration    minBackoff        = std::chrono::seconds(2),
+        Duration    maxBackoff        = std::chrono::minutes(5),
+        Duration    capabilityTimeout = std::chrono::minutes(10)
+    )
+        : mName              (std::move(name))
+        , mMinBackoff        (minBackoff)
+        , mMaxBackoff        (maxBackoff)
+        , mCapabilityTimeout (capabilityTimeout)
+    {
+    }
+
+    // False while backing off after failures.
+    auto CanRun () -> bool;
+
+    auto OnSuccess () -> void;
+    auto OnFailure (std::string_view reason) -> void;
+
+    // Probe is called first time, after invalidation, after failure or when
+    // cached value expires.
+    auto GetCapability (const ProbeFn& probe) -> bool;
+
+    auto Invalidate () -> void
+    {
+        mIsInvalidated = true;
+    }
+
+    auto GetFailureCount () const -> unsigned int
+    {
+        return mFailures;
+    }
+};
+
+} // namespace CaffeineTake
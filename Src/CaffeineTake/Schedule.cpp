@@ -25,8 +25,9 @@
 #include "Logger.hpp"
 #include "Utility.hpp"
 
+#include <algorithm>
 #include <chrono>
-#include <format>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -35,74 +36,120 @@
 
 namespace CaffeineTake {
 
-auto Schedule::CheckSchedule (
-    const std::vector<ScheduleEntry>&                  schedule,
-    std::chrono::time_point<std::chrono::system_clock> time
-) -> bool {
-#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_SCHEDULE)
-    return false;
-#else
-    static auto s_IsInSchedule = false;
-        
-    const auto tz = std::chrono::current_zone();
-    const auto localTime = tz->to_local(time);
-
-    const auto hh  = std::stoul(std::format("{:%H}", localTime));
-    const auto mm  = std::stoul(std::format("{:%M}", localTime));
-    const auto ss  = std::stoul(std::format("{:%S}", localTime));
-    const auto day = std::stoul(std::format("{:%u}", localTime));
-
-    // Convert day to DaysOfWeek.
-    const auto timeDayOfWeek = [&](){
-        switch (day)
-        {
-        case 0: return DaysOfWeek::Sunday;
-        case 1: return DaysOfWeek::Monday;
-        case 2: return DaysOfWeek::Tuesday;
-        case 3: return DaysOfWeek::Wednesday;
-        case 4: return DaysOfWeek::Thursday;
-        case 5: return DaysOfWeek::Friday;
-        case 6: return DaysOfWeek::Saturday;
-        case 7: return DaysOfWeek::Sunday;
-        }
-            
-        return DaysOfWeek::Monday;
-    }();
+#pragma region "CompiledSchedule"
 
-    const auto timeSeconds = (hh * 3600) + (mm * 60) + ss;
+auto CompiledSchedule::Compile (const std::vector<ScheduleEntry>& schedule) -> CompiledSchedule
+{
+    auto compiled = CompiledSchedule();
+    auto& ranges  = compiled.mRanges;
 
     for (const auto& entry : schedule)
     {
-        // Check if day match.
-        if ((entry.ActiveDays & timeDayOfWeek) == timeDayOfWeek)
+        for (auto day = 0u; day < 7; ++day)
         {
-            // Check if time match.
+            const auto dayOfWeek = static_cast<DaysOfWeek>(1u << day);
+            if ((entry.ActiveDays & dayOfWeek) != dayOfWeek)
+            {
+                continue;
+            }
+
+            // Entry end is inclusive.
             for (const auto& tr : entry.ActiveHours)
             {
-                if (tr.Begin <= timeSeconds && timeSeconds <= tr.End)
+                if (tr.Begin > tr.End || tr.Begin >= SecondsPerDay)
                 {
-                    if (!s_IsInSchedule)
-                    {
-                        const auto fmt = std::format(
-                            "Time is in schedule, {} in {}:[{}, {}]",
-                            localTime,
-                            static_cast<unsigned int>(timeDayOfWeek),
-                            tr.Begin,
-                            tr.End
-                        );
-                        LOG_INFO("{}", fmt);
-                    }
-                    s_IsInSchedule = true;
-                    return true;
+                    continue;
                 }
+
+                ranges.push_back(TimeRange{
+                    day * SecondsPerDay + tr.Begin,
+                    day * SecondsPerDay + std::min(tr.End, SecondsPerDay - 1) + 1
+                });
             }
         }
     }
 
-    s_IsInSchedule = false;
+    std::sort(
+        ranges.begin(), ranges.end(), [](const TimeRange& a, const TimeRange& b) { return a.Begin < b.Begin; }
+    );
+
+    // Merge overlapping and adjacent ranges.
+    auto merged = size_t{0};
+    for (auto i = size_t{0}; i < ranges.size(); ++i)
+    {
+        if (merged > 0 && ranges[i].Begin <= ranges[merged - 1].End)
+        {
+            ranges[merged - 1].End = std::max(ranges[merged - 1].End, ranges[i].End);
+        }
+        else
+        {
+            ranges[merged++] = ranges[i];
+        }
+    }
+
+    ranges.resize(merged);
+
+    return compiled;
+}
+
+auto CompiledSchedule::IsActive (unsigned int secondOfWeek) const -> bool
+{
+    // First range starting after second, previous one might contain it.
+    const auto it = std::upper_bound(
+        mRanges.begin(), mRanges.end(), secondOfWeek,
+        [](unsigned int second, const TimeRange& range) { return second < range.Begin; }
+    );
+
+    return it != mRanges.begin() && secondOfWeek < std::prev(it)->End;
+}
+
+auto CompiledSchedule::GetNextTransition (unsigned int secondOfWeek) const -> unsigned int
+{
+    if (mRanges.empty() || (mRanges.size() == 1 && mRanges[0].Begin == 0 && mRanges[0].End == SecondsPerWeek))
+    {
+        return 0;
+    }
+
+    const auto it = std::upper_bound(
+        mRanges.begin(), mRanges.end(), secondOfWeek,
+        [](unsigned int second, const TimeRange& range) { return second < range.Begin; }
+    );
+
+    // Inside range, state changes at its end unless it continues from
+    // start of the week.
+    if (it != mRanges.begin() && secondOfWeek < std::prev(it)->End)
+    {
+        const auto end = std::prev(it)->End;
+        if (end == SecondsPerWeek && mRanges.front().Begin == 0)
+        {
+            return SecondsPerWeek - secondOfWeek + mRanges.front().End;
+        }
+
+        return end - secondOfWeek;
+    }
+
+    // Outside, state changes at start of next range.
+    if (it != mRanges.end())
+    {
+        return it->Begin - secondOfWeek;
+    }
 
-    return false;
-#endif
+    return SecondsPerWeek - secondOfWeek + mRanges.front().Begin;
 }
 
+#pragma endregion
+
+#pragma region "Schedule"
+
+auto Schedule::GetWeekTime (
+    std::chrono::local_time<std::chrono::system_clock::duration> localTime
+) -> std::chrono::milliseconds {
+    const auto localDay  = std::chrono::floor<std::chrono::days>(localTime);
+    const auto weekday   = std::chrono::weekday(localDay).iso_encoding() - 1;  // 0 == Monday
+
+    return std::chrono::days(weekday) + std::chrono::duration_cast<std::chrono::milliseconds>(localTime - localDay);
+}
+
+#pragma endregion
+
 } // namespace CaffeineTake
@@ -57,13 +57,40 @@ struct ScheduleEntry
     TimeRangeList ActiveHours;
 };
 
+// Schedule entries flattened to sorted, non-overlapping ranges of seconds
+// since Monday 0:00. Lookup is binary search over few ranges, next state
+// change is known, so caller can sleep until then.
+class CompiledSchedule
+{
+public:
+    static constexpr auto SecondsPerDay  = 24u * 60 * 60;
+    static constexpr auto SecondsPerWeek = 7 * SecondsPerDay;
+
+private:
+    TimeRangeList mRanges = TimeRangeList();  // [Begin, End)
+
+public:
+    static auto Compile (const std::vector<ScheduleEntry>& schedule) -> CompiledSchedule;
+
+    auto IsActive (unsigned int secondOfWeek) const -> bool;
+
+    // Seconds from secondOfWeek to next state change, 0 if state never
+    // changes (empty or whole week).
+    auto GetNextTransition (unsigned int secondOfWeek) const -> unsigned int;
+
+    auto GetRangeCount () const -> size_t
+    {
+        return mRanges.size();
+    }
+};
+
 class Schedule
 {
 public:
-    static auto CheckSchedule (
-        const std::vector<ScheduleEntry>&                  schedule,
-        std::chrono::time_point<std::chrono::system_clock> time
-    ) -> bool;
+    // Time since Monday 0:00 of given local time.
+    static auto GetWeekTime (
+        std::chrono::local_time<std::chrono::system_clock::duration> localTime
+    ) -> std::chrono::milliseconds;
 };
 
 } // namespace CaffeineTake
@@ -27,6 +27,7 @@
 #include "BluetoothIdentifier.hpp"
 #include "CaffeineIcons.hpp"
 #include "Schedule.hpp"
+#include "UsbDeviceIdentifier.hpp"
 #include "Utility.hpp"
 
 #include <nlohmann/json.hpp>
@@ -54,6 +55,25 @@ struct adl_serializer<std::wstring>
 
 } // namespace nlohmann
 
+// Same as NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE, but missing keys keep their
+// default value. Used for settings added later, so older settings files
+// can still be loaded.
+#define CAFFEINETAKE_JSON_FROM_OPTIONAL(v1)                                   \
+    if (nlohmann_json_j.contains(#v1))                                        \
+    {                                                                         \
+        nlohmann_json_j.at(#v1).get_to(nlohmann_json_t.v1);                   \
+    }
+
+#define CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(Type, ...)                                                                   \
+    inline void to_json(nlohmann::json& nlohmann_json_j, const Type& nlohmann_json_t)                                 \
+    {                                                                                                                 \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(NLOHMANN_JSON_TO, __VA_ARGS__))                                      \
+    }                                                                                                                 \
+    inline void from_json(const nlohmann::json& nlohmann_json_j, Type& nlohmann_json_t)                               \
+    {                                                                                                                 \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(CAFFEINETAKE_JSON_FROM_OPTIONAL, __VA_ARGS__))                       \
+    }
+
 namespace CaffeineTake {
 
 // TimeRange serializer.
@@ -137,6 +157,18 @@ inline auto from_json (const nlohmann::json& j, BluetoothIdentifier& bi) -> void
     bi.ull = ull;
 }
 
+// UsbDeviceRule serializer. Rule is stored as written, older settings with
+// plain instance ids are parsed as single device rules.
+inline auto to_json (nlohmann::json& j, const UsbDeviceRule& rule) -> void
+{
+    j = nlohmann::json(rule.Text);
+}
+
+inline auto from_json (const nlohmann::json& j, UsbDeviceRule& rule) -> void
+{
+    rule = UsbDeviceRule::Parse(j.get<std::wstring>());
+}
+
 } // namespace CaffeineTake
 
 #endif
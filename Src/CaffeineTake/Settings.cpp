@@ -61,22 +61,51 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
 )
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Standard, Enabled, KeepScreenOn, WhenSessionLocked)
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerProcess, Enabled, Processes)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerWindow, Enabled, Windows)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerUsb, Enabled, UsbDevices)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerBluetooth, Enabled, BluetoothDevices, ActiveTimeout)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerProcess, Enabled, ScanInterval, Processes)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerWindow, Enabled, ScanInterval, Windows)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerFullscreen, Enabled, ScanInterval, IgnoredProcesses)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerUsb, Enabled, ScanInterval, UsbDevices)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerBluetooth, Enabled, ScanInterval, BluetoothDevices, ActiveTimeout)
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Auto::TriggerSchedule, Enabled, ScheduleEntries)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerNetwork, Enabled, ScanInterval, Threshold, OffThreshold, Window, Interfaces)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerDisk, Enabled, ScanInterval, Threshold, OffThreshold, IopsThreshold, IopsOffThreshold, Window, Disks)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerCpu, Enabled, ScanInterval, Threshold, OffThreshold, Window)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerTcp, Enabled, ScanInterval, Ports, Listeners)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerDirectory, Enabled, ScanInterval, Directories, ActiveTimeout)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerRemoteSession, Enabled, ScanInterval, Users, Hosts)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerJob, Enabled, ScanInterval, Jobs, CpuThreshold)
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(struct Settings::Auto::TriggerPidFile, Enabled, ScanInterval, Files, LockFiles)
+
+// Triggers are added over time, missing ones keep defaults.
+CAFFEINETAKE_DEFINE_TYPE_OPTIONAL(
     struct Settings::Auto,
     Enabled,
     KeepScreenOn,
     WhenSessionLocked,
     ScanInterval,
+    IdleAwareScan,
+    IdleScanFraction,
+    BatteryScanInterval,
+    BatteryTriggers,
+    Rule,
+    PriorityTriggers,
+    OnDelay,
+    OffDelay,
+    MinHoldTime,
     TriggerProcess,
     TriggerWindow,
+    TriggerFullscreen,
     TriggerUsb,
     TriggerBluetooth,
-    TriggerSchedule
+    TriggerSchedule,
+    TriggerNetwork,
+    TriggerDisk,
+    TriggerCpu,
+    TriggerTcp,
+    TriggerDirectory,
+    TriggerRemoteSession,
+    TriggerJob,
+    TriggerPidFile
 )
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(struct Settings::Timer, Enabled, KeepScreenOn, WhenSessionLocked, Interval)
@@ -24,6 +24,7 @@
 #include "CaffeineIcons.hpp"
 #include "CaffeineSounds.hpp"
 #include "Schedule.hpp"
+#include "UsbDeviceIdentifier.hpp"
 
 #include <filesystem>
 #include <memory>
@@ -78,36 +79,127 @@ public:
 
     struct Auto
     {
-        bool         Enabled            = true;
-        bool         KeepScreenOn       = true;
-        bool         WhenSessionLocked  = false;
-        unsigned int ScanInterval       = 2000;  // in ms
+        bool                      Enabled             = true;
+        bool                      KeepScreenOn        = true;
+        bool                      WhenSessionLocked   = false;
+        unsigned int              ScanInterval        = 2000;   // in ms
+        bool                      IdleAwareScan       = false;  // skip scans while user is active
+        unsigned int              IdleScanFraction    = 50;     // in %, of sleep timeout, idle time after which scanning resumes
+        unsigned int              BatteryScanInterval = 0;      // in ms, used on battery, 0 means same as ScanInterval
+        std::vector<std::wstring> BatteryTriggers     = std::vector<std::wstring>();  // trigger names scanned on battery, empty means all
+        std::wstring              Rule                = L"";    // trigger rule expression, empty means any enabled trigger
+        std::vector<std::wstring> PriorityTriggers    = std::vector<std::wstring>();  // trigger names scanned first, in order
+        unsigned int              OnDelay             = 0;      // in ms, trigger must hold before Auto mode activates
+        unsigned int              OffDelay            = 0;      // in ms, grace period before Auto mode deactivates
+        unsigned int              MinHoldTime         = 0;      // in ms, minimum time between Auto mode state changes
 
         struct TriggerProcess
         {
             bool                             Enabled          = true; 
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
             std::vector<std::wstring>        Processes        = std::vector<std::wstring>();
         } TriggerProcess;
 
         struct TriggerWindow
         {
             bool                             Enabled          = true; 
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
             std::vector<std::wstring>        Windows          = std::vector<std::wstring>();
         } TriggerWindow;
         
+        struct TriggerFullscreen
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            std::vector<std::wstring>        IgnoredProcesses = std::vector<std::wstring>();
+        } TriggerFullscreen;
+
         struct TriggerUsb
         {
             bool                             Enabled          = true;
-            std::vector<std::wstring>        UsbDevices       = std::vector<std::wstring>();
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            std::vector<UsbDeviceRule>       UsbDevices       = std::vector<UsbDeviceRule>();
         } TriggerUsb;
         
         struct TriggerBluetooth
         {
             bool                             Enabled          = true;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
             std::vector<BluetoothIdentifier> BluetoothDevices = std::vector<BluetoothIdentifier>({});
             unsigned int                     ActiveTimeout    = 60*1000;   // in ms
         } TriggerBluetooth;
 
+        struct TriggerNetwork
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            unsigned int                     Threshold        = 1024;       // in KiB/s, received + sent
+            unsigned int                     OffThreshold     = 256;        // in KiB/s, stays active until below, 0 means Threshold
+            unsigned int                     Window           = 10*1000;    // in ms
+            std::vector<std::wstring>        Interfaces       = std::vector<std::wstring>();  // empty means all hardware adapters
+        } TriggerNetwork;
+
+        struct TriggerDisk
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            unsigned int                     Threshold        = 4096;       // in KiB/s, read + written
+            unsigned int                     OffThreshold     = 1024;       // in KiB/s, stays active until below, 0 means Threshold
+            unsigned int                     IopsThreshold    = 0;          // in operations/s, 0 disables
+            unsigned int                     IopsOffThreshold = 0;          // in operations/s, 0 means IopsThreshold
+            unsigned int                     Window           = 10*1000;    // in ms
+            std::vector<std::wstring>        Disks            = std::vector<std::wstring>();  // PhysicalDriveN or "D:", empty means all disks
+        } TriggerDisk;
+
+        struct TriggerCpu
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            unsigned int                     Threshold        = 50;         // in %, all cores
+            unsigned int                     OffThreshold     = 30;         // in %, stays active until below, 0 means Threshold
+            unsigned int                     Window           = 30*1000;    // in ms, smoothing time constant
+        } TriggerCpu;
+
+        struct TriggerTcp
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            std::vector<unsigned short>      Ports            = std::vector<unsigned short>();  // established connection from or to port
+            std::vector<unsigned short>      Listeners        = std::vector<unsigned short>();  // connection accepted by local listener
+        } TriggerTcp;
+
+        struct TriggerDirectory
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            std::vector<std::wstring>        Directories      = std::vector<std::wstring>();  // watched with subdirectories
+            unsigned int                     ActiveTimeout    = 60*1000;    // in ms, since last change
+        } TriggerDirectory;
+
+        struct TriggerRemoteSession
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            std::vector<std::wstring>        Users            = std::vector<std::wstring>();  // empty means any user
+            std::vector<std::wstring>        Hosts            = std::vector<std::wstring>();  // client name or address, empty means any
+        } TriggerRemoteSession;
+
+        struct TriggerJob
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            std::vector<std::wstring>        Jobs             = std::vector<std::wstring>();  // job object names
+            unsigned int                     CpuThreshold     = 0;          // in %, all cores, 0 means any running process
+        } TriggerJob;
+
+        struct TriggerPidFile
+        {
+            bool                             Enabled          = false;
+            unsigned int                     ScanInterval     = 0;          // in ms, 0 means Auto.ScanInterval
+            std::vector<std::wstring>        Files            = std::vector<std::wstring>();  // pidfiles or lock files
+            bool                             LockFiles        = false;      // existing file is active, content isn't read
+        } TriggerPidFile;
+
         struct TriggerSchedule
         {
             bool                             Enabled          = true;
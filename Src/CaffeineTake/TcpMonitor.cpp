@@ -0,0 +1,200 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "TcpMonitor.hpp"
+
+#include "Logger.hpp"
+
+namespace CaffeineTake {
+
+namespace {
+    // Ports in tables are in network byte order in low 16 bits.
+    auto ToPort (DWORD value) -> unsigned short
+    {
+        return static_cast<unsigned short>(((value & 0xFF) << 8) | ((value >> 8) & 0xFF));
+    }
+
+    template <typename Table, typename Fn>
+    auto ForEachRow (const std::vector<BYTE>& buffer, Fn&& fn) -> bool
+    {
+        const auto table = reinterpret_cast<const Table*>(buffer.data());
+        for (auto i = DWORD{0}; i < table->dwNumEntries; ++i)
+        {
+            const auto& row = table->table[i];
+            if (fn(row.dwState, ToPort(row.dwLocalPort), ToPort(row.dwRemotePort)))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+auto TcpMonitor::ReadTable (ULONG family, std::vector<BYTE>& buffer) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP)
+    return false;
+#else
+    // Table can grow between calls, retry a few times.
+    for (auto i = 0; i < 3; ++i)
+    {
+        auto size = static_cast<DWORD>(buffer.size());
+        const auto result = GetExtendedTcpTable(
+            buffer.empty() ? NULL : buffer.data(), &size, FALSE, family, TCP_TABLE_OWNER_PID_ALL, 0
+        );
+
+        if (result == NO_ERROR)
+        {
+            return true;
+        }
+
+        if (result != ERROR_INSUFFICIENT_BUFFER)
+        {
+            LOG_ERROR("GetExtendedTcpTable() failed, error {}", result);
+            return false;
+        }
+
+        // Some headroom, so new connections don't force another resize.
+        buffer.resize(size + size / 4);
+    }
+
+    return false;
+#endif
+}
+
+auto TcpMonitor::SetRules (const std::vector<unsigned short>& ports, const std::vector<unsigned short>& listeners) -> void
+{
+    if (ports == mPortList && listeners == mListenerList)
+    {
+        return;
+    }
+
+    mPortList     = ports;
+    mListenerList = listeners;
+
+    mPorts.reset();
+    mListeners.reset();
+
+    for (const auto port : ports)
+    {
+        mPorts.set(port);
+    }
+    for (const auto port : listeners)
+    {
+        mListeners.set(port);
+    }
+}
+
+auto TcpMonitor::Find (bool& ok) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_TCP)
+    ok = false;
+    return false;
+#else
+    ok = true;
+
+    if (!HasRules())
+    {
+        return false;
+    }
+
+    const auto checkListeners = mListeners.any();
+    if (checkListeners)
+    {
+        mListening.reset();
+        mConnected.reset();
+    }
+
+    const auto check = [&](DWORD state, unsigned short local, unsigned short remote) {
+        if (state == MIB_TCP_STATE_ESTAB)
+        {
+            if (mPorts.test(local) || mPorts.test(remote))
+            {
+                mLastPort = mPorts.test(local) ? local : remote;
+                return true;
+            }
+
+            if (checkListeners && mListeners.test(local))
+            {
+                mConnected.set(local);
+            }
+        }
+        else if (checkListeners && state == MIB_TCP_STATE_LISTEN && mListeners.test(local))
+        {
+            mListening.set(local);
+        }
+
+        return false;
+    };
+
+    auto readAny = false;
+
+    if (ReadTable(AF_INET, mBuffer4))
+    {
+        readAny = true;
+        if (ForEachRow<MIB_TCPTABLE_OWNER_PID>(mBuffer4, check))
+        {
+            return true;
+        }
+    }
+
+    if (ReadTable(AF_INET6, mBuffer6))
+    {
+        readAny = true;
+        if (ForEachRow<MIB_TCP6TABLE_OWNER_PID>(mBuffer6, check))
+        {
+            return true;
+        }
+    }
+
+    if (!readAny)
+    {
+        ok = false;
+        return false;
+    }
+
+    // Listening and accepted sockets can be in different tables (dual stack).
+    if (checkListeners)
+    {
+        const auto accepted = mListening & mConnected;
+        if (accepted.any())
+        {
+            for (const auto port : mListenerList)
+            {
+                if (accepted.test(port))
+                {
+                    mLastPort = port;
+                    break;
+                }
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+#endif
+}
+
+} // namespace CaffeineTake
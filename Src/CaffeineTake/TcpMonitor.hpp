@@ -0,0 +1,75 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <bitset>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <winsock2.h>
+#include <iphlpapi.h>
+
+namespace CaffeineTake {
+
+// Looks for established TCP connections on selected ports. Rules are
+// compiled to port bitsets, so checking a socket is single lookup no matter
+// how many rules there are. Tables are read into buffers that are kept and
+// only grown, so steady state scan doesn't allocate.
+class TcpMonitor
+{
+    using PortSet = std::bitset<65536>;
+
+    std::vector<unsigned short> mPortList      = std::vector<unsigned short>();
+    std::vector<unsigned short> mListenerList  = std::vector<unsigned short>();
+    PortSet                     mPorts         = PortSet();  // local or remote port
+    PortSet                     mListeners     = PortSet();  // local port with listening socket
+    PortSet                     mListening     = PortSet();  // scratch, listening ports seen
+    PortSet                     mConnected     = PortSet();  // scratch, accepted connections seen
+    std::vector<BYTE>           mBuffer4       = std::vector<BYTE>();
+    std::vector<BYTE>           mBuffer6       = std::vector<BYTE>();
+    unsigned short              mLastPort      = 0;
+
+    auto ReadTable (ULONG family, std::vector<BYTE>& buffer) -> bool;
+
+public:
+    // Ports: any established connection from or to port.
+    // Listeners: established connection accepted by local listener on port.
+    auto SetRules (const std::vector<unsigned short>& ports, const std::vector<unsigned short>& listeners) -> void;
+
+    // Returns true if any rule matches, sets ok to false if tables can't be read.
+    auto Find (bool& ok) -> bool;
+
+    auto HasRules () const -> bool
+    {
+        return !mPortList.empty() || !mListenerList.empty();
+    }
+
+    // Port of last matching connection.
+    auto GetLastPort () const -> unsigned short
+    {
+        return mLastPort;
+    }
+};
+
+} // namespace CaffeineTake
@@ -123,6 +123,7 @@ private:
     std::atomic<bool>         mIsPaused               = false;
     std::atomic<bool>         mIsWaiting              = false;
     std::atomic<bool>         mInCallback             = false;
+    std::atomic<bool>         mIsWakeRequested        = false;
     const bool                mRunCallbackImmediately = false;           // run callback immediately after worker start
     StopToken                 mStopToken              = StopToken();
     PauseToken                mPauseToken             = PauseToken();
@@ -161,10 +162,11 @@ private:
                         mInterval,
                         [&]
                         {
-                            return mIsPaused || mIsDone; // return false to continue wait
+                            return mIsPaused || mIsDone || mIsWakeRequested; // return false to continue wait
                         }
                     );
-                    mIsWaiting = false;
+                    mIsWaiting       = false;
+                    mIsWakeRequested = false;
                 }
 
                 // Check if we finished.
@@ -273,9 +275,10 @@ public:
                 mStopToken.Reset();
                 mPauseToken.Reset();
 
-                mIsDone       = false;
-                mIsPaused     = false;
-                mWorkerThread = std::thread(&ThreadTimer::Worker, this);
+                mIsDone          = false;
+                mIsPaused        = false;
+                mIsWakeRequested = false;
+                mWorkerThread    = std::thread(&ThreadTimer::Worker, this);
             }
 
             if (mIsPaused)
@@ -343,6 +346,23 @@ public:
         }
     }
 
+    // Run callback now instead of waiting for the interval to elapse.
+    // If callback is running, next wait is skipped.
+    auto Wake () -> void
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+
+        if (!mIsDone && !mIsPaused)
+        {
+            mIsWakeRequested = true;
+
+            if (mIsWaiting)
+            {
+                mWorkerConditionVar.notify_one();
+            }
+        }
+    }
+
     auto SetCallback (CallbackFn callback) -> bool
     {
         auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
@@ -367,6 +387,18 @@ public:
         return mIsDone;
     }
 
+    // Unlike SetInterval works on running timer, new interval is used
+    // from next wait.
+    auto ChangeInterval (Interval interval) -> void
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mWorkerMutex);
+
+        if (interval > Interval(0))
+        {
+            mInterval = interval;
+        }
+    }
+
     auto GetInterval () const -> Interval
     {
         return mInterval;
@@ -0,0 +1,247 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include <bitset>
+#include <cwctype>
+#include <string>
+#include <string_view>
+
+namespace CaffeineTake {
+
+using UsbClassSet = std::bitset<256>;
+
+namespace UsbId {
+    // Case insensitive FNV-1a, instance ids are case insensitive.
+    inline auto Hash (std::wstring_view str) -> unsigned long long
+    {
+        auto hash = 14695981039346656037ull;
+        for (const auto c : str)
+        {
+            hash ^= static_cast<unsigned long long>(std::towupper(c));
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    // Parse hex number, returns false on failure.
+    inline auto ParseHex (std::wstring_view str, unsigned int& value) -> bool
+    {
+        if (str.empty() || str.size() > 8)
+        {
+            return false;
+        }
+
+        value = 0;
+        for (const auto c : str)
+        {
+            auto d = 0u;
+            if (L'0' <= c && c <= L'9')      d = c - L'0';
+            else if (L'a' <= c && c <= L'f') d = c - L'a' + 10;
+            else if (L'A' <= c && c <= L'F') d = c - L'A' + 10;
+            else                             return false;
+
+            value = (value << 4) | d;
+        }
+
+        return true;
+    }
+
+    // Check if str starts with prefix, case insensitive.
+    inline auto StartsWith (std::wstring_view str, std::wstring_view prefix) -> bool
+    {
+        if (str.size() < prefix.size())
+        {
+            return false;
+        }
+
+        for (auto i = size_t{0}; i < prefix.size(); ++i)
+        {
+            if (std::towupper(str[i]) != std::towupper(prefix[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+// USB device identity parsed from instance id, e.g.
+// USB\VID_046D&PID_C52B\5&2A0B1C&0&2
+struct UsbDeviceInfo
+{
+    unsigned short     Vid            = 0;
+    unsigned short     Pid            = 0;
+    bool               HasVidPid      = false;
+    unsigned long long SerialHash     = 0;
+    unsigned long long InstanceIdHash = 0;
+    UsbClassSet        Classes        = UsbClassSet();  // filled only when needed
+
+    static auto Parse (std::wstring_view instanceId) -> UsbDeviceInfo
+    {
+        auto info = UsbDeviceInfo();
+        info.InstanceIdHash = UsbId::Hash(instanceId);
+
+        // Enumerator\HardwarePart\InstancePart
+        const auto first = instanceId.find(L'\\');
+        if (first == std::wstring_view::npos)
+        {
+            return info;
+        }
+
+        const auto second   = instanceId.find(L'\\', first + 1);
+        const auto hardware = instanceId.substr(first + 1, second == std::wstring_view::npos ? std::wstring_view::npos : second - first - 1);
+
+        auto vid    = 0u;
+        auto pid    = 0u;
+        auto hasVid = false;
+        auto hasPid = false;
+
+        // VID_xxxx&PID_xxxx[&MI_xx][&...]
+        auto rest = hardware;
+        while (!rest.empty())
+        {
+            const auto amp   = rest.find(L'&');
+            const auto token = rest.substr(0, amp);
+
+            if (UsbId::StartsWith(token, L"VID_"))
+            {
+                hasVid = UsbId::ParseHex(token.substr(4), vid) && vid <= 0xFFFF;
+            }
+            else if (UsbId::StartsWith(token, L"PID_"))
+            {
+                hasPid = UsbId::ParseHex(token.substr(4), pid) && pid <= 0xFFFF;
+            }
+
+            rest = amp == std::wstring_view::npos ? std::wstring_view() : rest.substr(amp + 1);
+        }
+
+        if (hasVid && hasPid)
+        {
+            info.Vid       = static_cast<unsigned short>(vid);
+            info.Pid       = static_cast<unsigned short>(pid);
+            info.HasVidPid = true;
+        }
+
+        if (second != std::wstring_view::npos)
+        {
+            info.SerialHash = UsbId::Hash(instanceId.substr(second + 1));
+        }
+
+        return info;
+    }
+};
+
+enum class UsbRuleMatch : unsigned char
+{
+    Invalid,
+    InstanceId,     // unrecognized format, whole instance id must match
+    Device,         // USB\VID_xxxx&PID_xxxx\serial
+    VendorProduct,  // USB\VID_xxxx&PID_xxxx
+    Vendor,         // USB\VID_xxxx
+    Class           // USB\Class_xx
+};
+
+// Trigger rule as written in settings. Old settings contain full instance
+// ids, these are parsed as Device rules.
+struct UsbDeviceRule
+{
+    std::wstring       Text       = L"";
+    UsbRuleMatch       Match      = UsbRuleMatch::Invalid;
+    unsigned short     Vid        = 0;
+    unsigned short     Pid        = 0;
+    unsigned char      Class      = 0;
+    unsigned long long SerialHash = 0;  // or instance id hash for InstanceId rule
+
+    auto operator== (const UsbDeviceRule& other) const
+    {
+        return Text == other.Text;
+    }
+
+    static auto Parse (std::wstring_view text) -> UsbDeviceRule
+    {
+        auto rule = UsbDeviceRule();
+        rule.Text = std::wstring(text);
+
+        if (text.empty())
+        {
+            return rule;
+        }
+
+        // USB\Class_xx
+        if (UsbId::StartsWith(text, L"USB\\Class_"))
+        {
+            auto cls = 0u;
+            if (UsbId::ParseHex(text.substr(10), cls) && cls <= 0xFF)
+            {
+                rule.Match = UsbRuleMatch::Class;
+                rule.Class = static_cast<unsigned char>(cls);
+            }
+
+            return rule;
+        }
+
+        // USB\VID_xxxx
+        if (UsbId::StartsWith(text, L"USB\\VID_") && text.find(L'&') == std::wstring_view::npos)
+        {
+            auto vid = 0u;
+            if (UsbId::ParseHex(text.substr(8), vid) && vid <= 0xFFFF)
+            {
+                rule.Match = UsbRuleMatch::Vendor;
+                rule.Vid   = static_cast<unsigned short>(vid);
+            }
+
+            return rule;
+        }
+
+        // USB\VID_xxxx&PID_xxxx[\serial], anything else is matched as is.
+        const auto info      = UsbDeviceInfo::Parse(text);
+        const auto hasSerial = text.find(L'\\', 4) != std::wstring_view::npos;
+
+        if (info.HasVidPid && UsbId::StartsWith(text, L"USB\\"))
+        {
+            rule.Vid = info.Vid;
+            rule.Pid = info.Pid;
+
+            if (hasSerial)
+            {
+                rule.Match      = UsbRuleMatch::Device;
+                rule.SerialHash = info.SerialHash;
+            }
+            else
+            {
+                rule.Match = UsbRuleMatch::VendorProduct;
+            }
+        }
+        else
+        {
+            rule.Match      = UsbRuleMatch::InstanceId;
+            rule.SerialHash = info.InstanceIdHash;
+        }
+
+        return rule;
+    }
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,622 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "UsbDeviceSource.hpp"
+
+#include "Logger.hpp"
+
+#include <array>
+#include <cwctype>
+#include <string>
+#include <string_view>
+
+#include <initguid.h>
+#include <cfgmgr32.h>
+#include <devpkey.h>
+#include <usbiodef.h>
+
+namespace CaffeineTake {
+
+namespace {
+    // CM_Register_Notification is not available on Windows 7.
+    using CM_Register_NotificationFn   = CONFIGRET (WINAPI*)(PCM_NOTIFY_FILTER, PVOID, PCM_NOTIFY_CALLBACK, PHCMNOTIFICATION);
+    using CM_Unregister_NotificationFn = CONFIGRET (WINAPI*)(HCMNOTIFICATION);
+
+    // Symbolic link casing differs between interface list and notifications.
+    auto NormalizeSymbolicLink (std::wstring_view symbolicLink) -> std::wstring
+    {
+        auto link = std::wstring(symbolicLink);
+        for (auto& c : link)
+        {
+            c = static_cast<wchar_t>(std::towupper(c));
+        }
+
+        return link;
+    }
+
+    // Present GUID_DEVINTERFACE_USB_DEVICE interfaces as multi-sz list of
+    // symbolic links. Device might be connected between size query and
+    // read, retry few times.
+    auto ReadUsbDeviceInterfaces (std::vector<wchar_t>& buffer) -> CONFIGRET
+    {
+        auto result = CONFIGRET{CR_SUCCESS};
+        for (auto retry = 0; retry < 3; ++retry)
+        {
+            auto size = ULONG{0};
+            result = CM_Get_Device_Interface_List_SizeW(
+                &size, const_cast<LPGUID>(&GUID_DEVINTERFACE_USB_DEVICE), NULL, CM_GET_DEVICE_INTERFACE_LIST_PRESENT
+            );
+            if (result != CR_SUCCESS)
+            {
+                break;
+            }
+
+            if (size > buffer.size())
+            {
+                buffer.resize(size);
+            }
+
+            result = CM_Get_Device_Interface_ListW(
+                const_cast<LPGUID>(&GUID_DEVINTERFACE_USB_DEVICE), NULL, buffer.data(), static_cast<ULONG>(buffer.size()), CM_GET_DEVICE_INTERFACE_LIST_PRESENT
+            );
+            if (result != CR_BUFFER_SMALL)
+            {
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    // Reads into caller's buffer, empty if device was removed meanwhile.
+    auto ReadInterfaceInstanceId (const wchar_t* symbolicLink, UsbInstanceIdBuffer& buffer) -> std::wstring_view
+    {
+        auto type   = DEVPROPTYPE{0};
+        auto size   = ULONG{sizeof(buffer)};
+
+        const auto result = CM_Get_Device_Interface_PropertyW(
+            symbolicLink,
+            &DEVPKEY_Device_InstanceId,
+            &type,
+            reinterpret_cast<PBYTE>(buffer.data()),
+            &size,
+            0
+        );
+
+        if (result != CR_SUCCESS || type != DEVPROP_TYPE_STRING)
+        {
+            return std::wstring_view();
+        }
+
+        buffer.back() = L'\0';
+        return std::wstring_view(buffer.data());
+    }
+
+    auto GetInterfaceInstanceId (const wchar_t* symbolicLink) -> std::wstring
+    {
+        auto buffer = UsbInstanceIdBuffer{ 0 };
+        return std::wstring(ReadInterfaceInstanceId(symbolicLink, buffer));
+    }
+
+    // Compatible ids are USB\Class_xx&SubClass_xx&Prot_xx for interfaces and
+    // single interface devices, USB\DevClass_xx&... for composite devices.
+    auto AddDevNodeClasses (DEVINST devInst, UsbClassSet& classes) -> void
+    {
+        auto buffer = std::array<wchar_t, 512>{ 0 };
+        auto size   = ULONG{sizeof(buffer) - 2 * sizeof(wchar_t)};
+
+        const auto result = CM_Get_DevNode_Registry_PropertyW(
+            devInst, CM_DRP_COMPATIBLEIDS, NULL, buffer.data(), &size, 0
+        );
+
+        if (result != CR_SUCCESS)
+        {
+            return;
+        }
+
+        for (auto p = buffer.data(); *p != L'\0'; )
+        {
+            const auto id = std::wstring_view(p);
+
+            auto cls = 0u;
+            if (UsbId::StartsWith(id, L"USB\\Class_") && UsbId::ParseHex(id.substr(10, 2), cls))
+            {
+                classes.set(cls);
+            }
+            else if (UsbId::StartsWith(id, L"USB\\DevClass_") && UsbId::ParseHex(id.substr(13, 2), cls))
+            {
+                classes.set(cls);
+            }
+
+            p += id.size() + 1;
+        }
+    }
+
+    auto IsInterfaceDevNode (DEVINST devInst) -> bool
+    {
+        auto buffer = std::array<wchar_t, MAX_DEVICE_ID_LEN + 1>{ 0 };
+        if (CM_Get_Device_IDW(devInst, buffer.data(), MAX_DEVICE_ID_LEN, 0) != CR_SUCCESS)
+        {
+            return false;
+        }
+
+        return std::wstring_view(buffer.data()).find(L"&MI_") != std::wstring_view::npos;
+    }
+}
+
+auto GetUsbDeviceClasses (std::wstring_view instanceId) -> UsbClassSet
+{
+    auto classes = UsbClassSet();
+
+#if defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    auto id      = std::wstring(instanceId);
+    auto devInst = DEVINST{0};
+    if (CM_Locate_DevNodeW(&devInst, id.data(), CM_LOCATE_DEVNODE_NORMAL) != CR_SUCCESS)
+    {
+        return classes;
+    }
+
+    AddDevNodeClasses(devInst, classes);
+
+    // Composite device, interfaces are child nodes. Skip other children,
+    // devices connected to hub are children of the hub.
+    auto child = DEVINST{0};
+    if (CM_Get_Child(&child, devInst, 0) == CR_SUCCESS)
+    {
+        do
+        {
+            if (IsInterfaceDevNode(child))
+            {
+                AddDevNodeClasses(child, classes);
+            }
+        }
+        while (CM_Get_Sibling(&child, child, 0) == CR_SUCCESS);
+    }
+#endif
+
+    return classes;
+}
+
+auto IsUsbDevicePresent (const std::wstring& instanceId) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    return false;
+#else
+    // Normal lookup fails for devices that are not present.
+    auto devInst = DEVINST{0};
+    return CM_Locate_DevNodeW(&devInst, const_cast<DEVINSTID_W>(instanceId.c_str()), CM_LOCATE_DEVNODE_NORMAL) == CR_SUCCESS;
+#endif
+}
+
+#pragma region "UsbDeviceIndex"
+
+auto UsbDeviceIndex::Build (const std::vector<UsbDeviceRule>& rules) -> bool
+{
+    if (rules == mRules)
+    {
+        return false;
+    }
+
+    mRules = rules;
+    mDevices.clear();
+    mVendorProducts.clear();
+    mVendors.clear();
+    mInstanceIds.clear();
+    mClassRules.clear();
+    mClasses.reset();
+
+    for (auto i = size_t{0}; i < mRules.size(); ++i)
+    {
+        const auto& rule = mRules[i];
+
+        // Within same match type first rule wins. Across types more
+        // specific match wins, see Match().
+        switch (rule.Match)
+        {
+        case UsbRuleMatch::Device:
+            mDevices.emplace(DeviceKey(rule.Vid, rule.Pid, rule.SerialHash), i);
+            break;
+
+        case UsbRuleMatch::VendorProduct:
+            mVendorProducts.emplace((static_cast<unsigned long>(rule.Vid) << 16) | rule.Pid, i);
+            break;
+
+        case UsbRuleMatch::Vendor:
+            mVendors.emplace(rule.Vid, i);
+            break;
+
+        case UsbRuleMatch::InstanceId:
+            mInstanceIds.emplace(rule.SerialHash, i);
+            break;
+
+        case UsbRuleMatch::Class:
+            mClassRules.emplace(rule.Class, i);
+            mClasses.set(rule.Class);
+            break;
+
+        default:
+        case UsbRuleMatch::Invalid:
+            LOG_WARNING(L"Invalid USB device rule: '{}'", rule.Text);
+            break;
+        }
+    }
+
+    LOG_DEBUG(
+        "Built USB device index, {} devices, {} products, {} vendors, {} classes",
+        mDevices.size() + mInstanceIds.size(), mVendorProducts.size(), mVendors.size(), mClassRules.size()
+    );
+
+    return true;
+}
+
+auto UsbDeviceIndex::Match (const UsbDeviceInfo& device) const -> const UsbDeviceRule*
+{
+    // Most specific match first, instance id, device, product, vendor and
+    // class, no matter the rule order.
+    if (!mInstanceIds.empty())
+    {
+        const auto it = mInstanceIds.find(device.InstanceIdHash);
+        if (it != mInstanceIds.end())
+        {
+            return &mRules[it->second];
+        }
+    }
+
+    if (device.HasVidPid)
+    {
+        if (!mDevices.empty())
+        {
+            const auto it = mDevices.find(DeviceKey(device.Vid, device.Pid, device.SerialHash));
+            if (it != mDevices.end())
+            {
+                const auto& rule = mRules[it->second];
+                if (rule.Vid == device.Vid && rule.Pid == device.Pid && rule.SerialHash == device.SerialHash)
+                {
+                    return &rule;
+                }
+            }
+        }
+
+        if (!mVendorProducts.empty())
+        {
+            const auto it = mVendorProducts.find((static_cast<unsigned long>(device.Vid) << 16) | device.Pid);
+            if (it != mVendorProducts.end())
+            {
+                return &mRules[it->second];
+            }
+        }
+
+        if (!mVendors.empty())
+        {
+            const auto it = mVendors.find(device.Vid);
+            if (it != mVendors.end())
+            {
+                return &mRules[it->second];
+            }
+        }
+    }
+
+    const auto classes = mClasses & device.Classes;
+    if (classes.any())
+    {
+        for (auto c = size_t{0}; c < classes.size(); ++c)
+        {
+            if (classes.test(c))
+            {
+                return &mRules[mClassRules.at(static_cast<unsigned char>(c))];
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+#pragma endregion
+
+#pragma region "ConfigManagerUsbDeviceSource"
+
+auto ConfigManagerUsbDeviceSource::Enumerate (EnumerateFn callback) -> ScanResult
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    return ScanResult::Failure;
+#else
+    const auto result = ReadUsbDeviceInterfaces(mBuffer);
+    if (result != CR_SUCCESS)
+    {
+        // Reported by scanner, rate limited.
+        LOG_DEBUG("CM_Get_Device_Interface_ListW() failed with error: {}", result);
+        return ScanResult::Failure;
+    }
+
+    // Multi-sz list, terminated with empty string.
+    for (auto p = mBuffer.data(); p && *p != L'\0'; )
+    {
+        const auto symbolicLink = std::wstring_view(p);
+        const auto instanceId   = ReadInterfaceInstanceId(p, mInstanceId);
+
+        p += symbolicLink.size() + 1;
+
+        // Removed after list was read.
+        if (instanceId.empty())
+        {
+            continue;
+        }
+
+        const auto scanResult = callback(instanceId);
+        if (scanResult != ScanResult::Continue)
+        {
+            return scanResult;
+        }
+    }
+
+    return ScanResult::Continue;
+#endif
+}
+
+#pragma endregion
+
+#pragma region "UsbHotplugMonitor"
+
+DWORD CALLBACK UsbHotplugMonitor::NotificationCallback (
+    HCMNOTIFICATION       hNotify,
+    PVOID                 context,
+    CM_NOTIFY_ACTION      action,
+    PCM_NOTIFY_EVENT_DATA eventData,
+    DWORD                 eventDataSize
+)
+{
+    const auto monitor = static_cast<UsbHotplugMonitor*>(context);
+    if (!monitor || !eventData || eventData->FilterType != CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    const auto symbolicLink = eventData->u.DeviceInterface.SymbolicLink;
+
+    switch (action)
+    {
+    case CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL:
+        monitor->OnArrival(symbolicLink, GetInterfaceInstanceId(symbolicLink));
+        break;
+
+    case CM_NOTIFY_ACTION_DEVICEINTERFACEREMOVAL:
+        monitor->OnRemoval(symbolicLink);
+        break;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+auto UsbHotplugMonitor::AddPresentInterfaces () -> bool
+{
+    auto buffer = std::vector<wchar_t>();
+
+    const auto result = ReadUsbDeviceInterfaces(buffer);
+    if (result != CR_SUCCESS)
+    {
+        LOG_ERROR("CM_Get_Device_Interface_ListW() failed with error: {}", result);
+        return false;
+    }
+
+    for (auto p = buffer.data(); p && *p != L'\0'; )
+    {
+        const auto symbolicLink = std::wstring_view(p);
+        OnArrival(symbolicLink, GetInterfaceInstanceId(p));
+        p += symbolicLink.size() + 1;
+    }
+
+    return true;
+}
+
+auto UsbHotplugMonitor::Start (ChangeFn onChange) -> bool
+{
+#if !defined(FEATURE_CAFFEINETAKE_AUTO_MODE_TRIGGER_USB)
+    return false;
+#else
+    if (mIsRunning)
+    {
+        return true;
+    }
+
+    if (!mLibCfgmgr32)
+    {
+        mLibCfgmgr32 = LoadLibraryW(L"cfgmgr32.dll");
+    }
+
+    const auto fnRegister = mLibCfgmgr32
+        ? reinterpret_cast<CM_Register_NotificationFn>(GetProcAddress(mLibCfgmgr32, "CM_Register_Notification"))
+        : nullptr;
+
+    if (!fnRegister)
+    {
+        LOG_WARNING("CM_Register_Notification() is not available, falling back to USB device scanning");
+        return false;
+    }
+
+    auto filter = CM_NOTIFY_FILTER{};
+    ZeroMemory(&filter, sizeof(filter));
+    filter.cbSize                        = sizeof(filter);
+    filter.FilterType                    = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+    filter.u.DeviceInterface.ClassGuid   = GUID_DEVINTERFACE_USB_DEVICE;
+
+    // Register first, devices connected while reading the list are not lost.
+    const auto result = fnRegister(&filter, this, &UsbHotplugMonitor::NotificationCallback, &mNotification);
+    if (result != CR_SUCCESS)
+    {
+        LOG_ERROR("CM_Register_Notification() failed with error: {}", result);
+        mNotification = NULL;
+        return false;
+    }
+
+    if (!AddPresentInterfaces())
+    {
+        Stop();
+        return false;
+    }
+
+    auto devices = size_t{0};
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        mOnChange = onChange;
+        devices   = mDevices.size();
+    }
+
+    mIsRunning = true;
+
+    LOG_INFO("Started USB hotplug monitoring, {} devices present", devices);
+
+    return true;
+#endif
+}
+
+auto UsbHotplugMonitor::Stop () -> void
+{
+    if (mNotification)
+    {
+        const auto fnUnregister = reinterpret_cast<CM_Unregister_NotificationFn>(
+            GetProcAddress(mLibCfgmgr32, "CM_Unregister_Notification")
+        );
+
+        // Waits for callbacks in progress.
+        if (fnUnregister)
+        {
+            fnUnregister(mNotification);
+        }
+
+        mNotification = NULL;
+    }
+
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    mOnChange = nullptr;
+    mInterfaces.clear();
+    mDevices.clear();
+    mGeneration += 1;
+
+    if (mIsRunning)
+    {
+        mIsRunning = false;
+        LOG_INFO("Stopped USB hotplug monitoring");
+    }
+}
+
+auto UsbHotplugMonitor::Contains (const std::wstring& instanceId) const -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    return mDevices.contains(instanceId);
+}
+
+auto UsbHotplugMonitor::Find (const UsbDeviceIndex& index) -> std::wstring
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+    for (auto& [instanceId, device] : mDevices)
+    {
+        if (index.NeedsClasses() && !device.HasClasses)
+        {
+            device.Info.Classes = GetUsbDeviceClasses(instanceId);
+            device.HasClasses   = IsUsbClassSetComplete(device.Info.Classes);
+        }
+
+        if (index.Match(device.Info))
+        {
+            return instanceId;
+        }
+    }
+
+    return std::wstring();
+}
+
+auto UsbHotplugMonitor::OnArrival (std::wstring_view symbolicLink, std::wstring instanceId) -> void
+{
+    if (instanceId.empty())
+    {
+        return;
+    }
+
+    auto onChange = ChangeFn();
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+        const auto [it, inserted] = mInterfaces.emplace(NormalizeSymbolicLink(symbolicLink), instanceId);
+        if (!inserted)
+        {
+            return;
+        }
+
+        auto& device = mDevices[instanceId];
+        device.InterfaceCount += 1;
+
+        if (device.InterfaceCount == 1)
+        {
+            device.Info = UsbDeviceInfo::Parse(instanceId);
+
+            LOG_DEBUG(L"USB device arrived: '{}'", instanceId);
+            mGeneration += 1;
+            onChange = mOnChange;
+        }
+    }
+
+    if (onChange)
+    {
+        onChange();
+    }
+}
+
+auto UsbHotplugMonitor::OnRemoval (std::wstring_view symbolicLink) -> void
+{
+    auto onChange = ChangeFn();
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+        const auto it = mInterfaces.find(NormalizeSymbolicLink(symbolicLink));
+        if (it == mInterfaces.end())
+        {
+            return;
+        }
+
+        const auto deviceIt = mDevices.find(it->second);
+        if (deviceIt != mDevices.end())
+        {
+            deviceIt->second.InterfaceCount -= 1;
+
+            if (deviceIt->second.InterfaceCount <= 0)
+            {
+                LOG_DEBUG(L"USB device removed: '{}'", deviceIt->first);
+                mDevices.erase(deviceIt);
+                mGeneration += 1;
+                onChange = mOnChange;
+            }
+        }
+
+        mInterfaces.erase(it);
+    }
+
+    if (onChange)
+    {
+        onChange();
+    }
+}
+
+#pragma endregion
+
+} // namespace CaffeineTake
@@ -0,0 +1,196 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#pragma once
+
+#include "UsbDeviceIdentifier.hpp"
+#include "Utility.hpp"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <cfgmgr32.h>
+
+namespace CaffeineTake {
+
+// Collect USB class codes of device and its interfaces (composite devices
+// define classes per interface) from compatible ids.
+auto GetUsbDeviceClasses (std::wstring_view instanceId) -> UsbClassSet;
+
+// Single devnode lookup, doesn't enumerate devices.
+auto IsUsbDevicePresent (const std::wstring& instanceId) -> bool;
+
+// Composite device classes (00, EF) only, interfaces are not there yet.
+inline auto IsUsbClassSetComplete (UsbClassSet classes) -> bool
+{
+    classes.reset(0x00);
+    classes.reset(0xEF);
+    return classes.any();
+}
+
+// Trigger rules indexed by parsed keys, device is matched with few hash
+// lookups no matter how many rules there are.
+class UsbDeviceIndex
+{
+    std::vector<UsbDeviceRule>                     mRules          = std::vector<UsbDeviceRule>();
+    std::unordered_map<unsigned long long, size_t> mDevices        = std::unordered_map<unsigned long long, size_t>(); // vid, pid, serial
+    std::unordered_map<unsigned long, size_t>      mVendorProducts = std::unordered_map<unsigned long, size_t>();      // vid << 16 | pid
+    std::unordered_map<unsigned short, size_t>     mVendors        = std::unordered_map<unsigned short, size_t>();
+    std::unordered_map<unsigned long long, size_t> mInstanceIds    = std::unordered_map<unsigned long long, size_t>();
+    std::unordered_map<unsigned char, size_t>      mClassRules     = std::unordered_map<unsigned char, size_t>();
+    UsbClassSet                                    mClasses        = UsbClassSet();
+
+    static auto DeviceKey (unsigned short vid, unsigned short pid, unsigned long long serialHash) -> unsigned long long
+    {
+        return serialHash ^ ((static_cast<unsigned long long>(vid) << 48) | (static_cast<unsigned long long>(pid) << 32));
+    }
+
+public:
+    // Returns true if index was rebuilt, rules are compared with previous
+    // ones so this can be called on every scan.
+    auto Build (const std::vector<UsbDeviceRule>& rules) -> bool;
+
+    // Returns most specific matching rule, not first one in rule order.
+    auto Match (const UsbDeviceInfo& device) const -> const UsbDeviceRule*;
+
+    auto IsEmpty () const -> bool
+    {
+        return mRules.empty();
+    }
+
+    // Class information is expensive to get, query it only if needed.
+    auto NeedsClasses () const -> bool
+    {
+        return mClasses.any();
+    }
+};
+
+using UsbInstanceIdBuffer = std::array<wchar_t, MAX_DEVICE_ID_LEN + 1>;
+
+// Enumerates USB devices present in the system. Instance id passed to
+// callback is valid only for the duration of the call.
+class UsbDeviceSource
+{
+public:
+    using EnumerateFn = std::function<ScanResult (std::wstring_view instanceId)>;
+
+    virtual ~UsbDeviceSource() {}
+
+    // Returns ScanResult::Success or ScanResult::Stop if callback returned
+    // it, ScanResult::Continue if all devices were enumerated and
+    // ScanResult::Failure if device list couldn't be read.
+    virtual auto Enumerate (EnumerateFn callback) -> ScanResult = 0;
+};
+
+// Reads whole USB device interface list with single
+// CM_Get_Device_Interface_ListW() call, same device set as hotplug monitor
+// (no interface, hub or root hub nodes). Interface list and instance id
+// buffers are kept between enumerations, so there are no allocations
+// unless the list grows.
+class ConfigManagerUsbDeviceSource : public UsbDeviceSource
+{
+    std::vector<wchar_t> mBuffer     = std::vector<wchar_t>();
+    UsbInstanceIdBuffer  mInstanceId = UsbInstanceIdBuffer{ 0 };  // id passed to callback, valid during the call
+
+public:
+    auto Enumerate (EnumerateFn callback) -> ScanResult override;
+};
+
+// Keeps set of present USB devices up to date from device interface
+// arrival/removal notifications, so presence check doesn't require
+// enumerating all devices.
+class UsbHotplugMonitor
+{
+public:
+    using ChangeFn = std::function<void ()>;
+
+private:
+    struct Device
+    {
+        int           InterfaceCount = 0;
+        bool          HasClasses     = false;   // composite device interfaces show up later
+        UsbDeviceInfo Info           = UsbDeviceInfo();
+    };
+
+    HMODULE                                       mLibCfgmgr32  = NULL;
+    HCMNOTIFICATION                               mNotification = NULL;
+    ChangeFn                                      mOnChange     = nullptr;
+    mutable std::mutex                            mMutex;
+    std::unordered_map<std::wstring, std::wstring> mInterfaces  = std::unordered_map<std::wstring, std::wstring>(); // symbolic link -> instance id
+    std::unordered_map<std::wstring, Device>       mDevices     = std::unordered_map<std::wstring, Device>();       // instance id -> device
+    std::atomic<unsigned long long>               mGeneration   = 0;
+    std::atomic<bool>                             mIsRunning    = false;
+
+    auto AddPresentInterfaces () -> bool;
+
+    static DWORD CALLBACK NotificationCallback (
+        HCMNOTIFICATION       hNotify,
+        PVOID                 context,
+        CM_NOTIFY_ACTION      action,
+        PCM_NOTIFY_EVENT_DATA eventData,
+        DWORD                 eventDataSize
+    );
+
+public:
+    ~UsbHotplugMonitor ()
+    {
+        Stop();
+
+        if (mLibCfgmgr32)
+        {
+            FreeLibrary(mLibCfgmgr32);
+        }
+    }
+
+    auto Start (ChangeFn onChange) -> bool;
+    auto Stop  () -> void;
+
+    auto IsRunning () const -> bool
+    {
+        return mIsRunning;
+    }
+
+    // Incremented every time device is added or removed.
+    auto GetGeneration () const -> unsigned long long
+    {
+        return mGeneration;
+    }
+
+    auto Contains (const std::wstring& instanceId) const -> bool;
+
+    // Returns instance id of first present device matching any rule.
+    auto Find (const UsbDeviceIndex& index) -> std::wstring;
+
+    // Called from notification callback, public so events can be injected.
+    auto OnArrival (std::wstring_view symbolicLink, std::wstring instanceId) -> void;
+    auto OnRemoval (std::wstring_view symbolicLink) -> void;
+};
+
+} // namespace CaffeineTake
@@ -0,0 +1,573 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+
+#include "PCH.hpp"
+#include "Config.hpp"
+#include "WindowTracker.hpp"
+
+#include "Logger.hpp"
+#include "Utility.hpp"
+
+#include <array>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace CaffeineTake {
+
+#pragma region "WinEventWindowSource"
+
+namespace {
+    // Hook callback doesn't take user data, but it's always called on the
+    // thread that installed the hook.
+    thread_local WinEventWindowSource* tlsWindowSource = nullptr;
+}
+
+void CALLBACK WinEventWindowSource::WinEventProc (
+    HWINEVENTHOOK hWinEventHook,
+    DWORD         event,
+    HWND          hWnd,
+    LONG          idObject,
+    LONG          idChild,
+    DWORD         idEventThread,
+    DWORD         dwmsEventTime
+)
+{
+    // We are only interested in windows, not in their child objects.
+    if (hWnd == NULL || idObject != OBJID_WINDOW || idChild != CHILDID_SELF)
+    {
+        return;
+    }
+
+    const auto source = tlsWindowSource;
+    if (!source || !source->mCallback)
+    {
+        return;
+    }
+
+    switch (event)
+    {
+    case EVENT_OBJECT_CREATE:     source->mCallback(WindowEvent::Create, hWnd);     break;
+    case EVENT_OBJECT_DESTROY:    source->mCallback(WindowEvent::Destroy, hWnd);    break;
+    case EVENT_OBJECT_SHOW:       source->mCallback(WindowEvent::Show, hWnd);       break;
+    case EVENT_OBJECT_HIDE:       source->mCallback(WindowEvent::Hide, hWnd);       break;
+    case EVENT_OBJECT_NAMECHANGE: source->mCallback(WindowEvent::NameChange, hWnd); break;
+
+    case EVENT_SYSTEM_FOREGROUND:
+        source->HookLocationChange(hWnd);
+        source->mCallback(WindowEvent::Foreground, hWnd);
+        break;
+
+    case EVENT_SYSTEM_MINIMIZESTART:
+    case EVENT_SYSTEM_MINIMIZEEND:
+    case EVENT_OBJECT_LOCATIONCHANGE:
+        source->mCallback(WindowEvent::LocationChange, hWnd);
+        break;
+    }
+}
+
+auto WinEventWindowSource::HookLocationChange (HWND hWnd) -> void
+{
+    // Location changes are noisy, so listen only to the process that owns
+    // foreground window.
+    auto pid = DWORD{0};
+    GetWindowThreadProcessId(hWnd, &pid);
+
+    if (mLocationHook && pid == mLocationPid)
+    {
+        return;
+    }
+
+    if (mLocationHook)
+    {
+        UnhookWinEvent(mLocationHook);
+        mLocationHook = NULL;
+    }
+
+    mLocationPid = pid;
+    if (pid != 0)
+    {
+        mLocationHook = SetWinEventHook(
+            EVENT_OBJECT_LOCATIONCHANGE,
+            EVENT_OBJECT_LOCATIONCHANGE,
+            NULL,
+            WinEventProc,
+            pid,
+            0,
+            WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS
+        );
+    }
+}
+
+auto WinEventWindowSource::Worker (std::promise<bool> started) -> void
+{
+    tlsWindowSource = this;
+
+    // Force message queue creation, otherwise PostThreadMessage might fail.
+    auto msg = MSG{};
+    PeekMessageW(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+
+    const auto flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+
+    auto hooks   = std::vector<HWINEVENTHOOK>();
+    auto addHook = [&](DWORD eventMin, DWORD eventMax)
+    {
+        auto hook = SetWinEventHook(eventMin, eventMax, NULL, WinEventProc, 0, 0, flags);
+        if (hook)
+        {
+            hooks.push_back(hook);
+        }
+
+        return hook != NULL;
+    };
+
+    auto success = true;
+
+    // Two hooks, EVENT_OBJECT_LOCATIONCHANGE is between HIDE and NAMECHANGE
+    // and it's fired on every cursor move.
+    if ((mGroups & WindowEventGroup::Lifetime) == WindowEventGroup::Lifetime)
+    {
+        success = success
+            && addHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_HIDE)
+            && addHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE);
+    }
+
+    if ((mGroups & WindowEventGroup::Foreground) == WindowEventGroup::Foreground)
+    {
+        success = success
+            && addHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND)
+            && addHook(EVENT_SYSTEM_MINIMIZESTART, EVENT_SYSTEM_MINIMIZEEND);
+    }
+
+    if (!success)
+    {
+        LOG_ERROR("SetWinEventHook() failed with error: {}", GetLastError());
+
+        for (auto hook : hooks)
+        {
+            UnhookWinEvent(hook);
+        }
+
+        tlsWindowSource = nullptr;
+        started.set_value(false);
+        return;
+    }
+
+    started.set_value(true);
+
+    // There will be no event for window that is already in foreground.
+    if ((mGroups & WindowEventGroup::Foreground) == WindowEventGroup::Foreground)
+    {
+        if (auto hWnd = ::GetForegroundWindow())
+        {
+            HookLocationChange(hWnd);
+            mCallback(WindowEvent::Foreground, hWnd);
+        }
+    }
+
+    while (GetMessageW(&msg, NULL, 0, 0) > 0)
+    {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+
+    if (mLocationHook)
+    {
+        UnhookWinEvent(mLocationHook);
+        mLocationHook = NULL;
+        mLocationPid  = 0;
+    }
+
+    for (auto hook : hooks)
+    {
+        UnhookWinEvent(hook);
+    }
+
+    tlsWindowSource = nullptr;
+}
+
+auto WinEventWindowSource::Start (EventFn callback) -> bool
+{
+    if (mThread.joinable())
+    {
+        return false;
+    }
+
+    mCallback = callback;
+
+    auto started = std::promise<bool>();
+    auto result  = started.get_future();
+
+    mThread   = std::thread(&WinEventWindowSource::Worker, this, std::move(started));
+    mThreadId = GetThreadId(mThread.native_handle());
+
+    if (!result.get())
+    {
+        mThread.join();
+        mThreadId = 0;
+        mCallback = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+auto WinEventWindowSource::Stop () -> void
+{
+    if (mThread.joinable())
+    {
+        PostThreadMessageW(mThreadId, WM_QUIT, 0, 0);
+        mThread.join();
+    }
+
+    mThreadId = 0;
+    mCallback = nullptr;
+}
+
+#pragma endregion
+
+#pragma region "WindowTracker"
+
+auto WindowTracker::OnWindowEvent (WindowEvent event, HWND hWnd) -> void
+{
+    auto changed  = std::vector<std::wstring>();
+    auto onChange = ChangeFn();
+
+    // Callback is called after lock is released, so it can't take locks
+    // in opposite order.
+    const auto notify = [&]() {
+        if (onChange)
+        {
+            for (const auto& title : changed)
+            {
+                onChange(title);
+            }
+        }
+    };
+
+    if (event == WindowEvent::Destroy)
+    {
+        {
+            auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+            Erase(hWnd, changed);
+            onChange = mOnChange;
+        }
+
+        notify();
+        return;
+    }
+
+    if (event == WindowEvent::Foreground || event == WindowEvent::LocationChange)
+    {
+        return;
+    }
+
+    // Only top-level windows, same as ScanWindows().
+    if (GetAncestor(hWnd, GA_PARENT) != GetDesktopWindow())
+    {
+        return;
+    }
+
+    // Read window state outside of lock. Window without title or hidden
+    // window is removed from index.
+    auto title = std::wstring();
+    if (IsWindowVisible(hWnd) || IsIconic(hWnd))
+    {
+        const auto length = GetWindowTextLengthW(hWnd);
+        if (length > 0)
+        {
+            title.resize(static_cast<size_t>(length) + 1);
+            const auto copied = GetWindowTextW(hWnd, title.data(), length + 1);
+            title.resize(copied > 0 ? static_cast<size_t>(copied) : 0);
+        }
+    }
+
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+        if (title.empty())
+        {
+            Erase(hWnd, changed);
+        }
+        else
+        {
+            Insert(hWnd, std::move(title), changed);
+        }
+
+        onChange = mOnChange;
+    }
+
+    notify();
+}
+
+auto WindowTracker::Insert (HWND hWnd, std::wstring title, std::vector<std::wstring>& changed) -> void
+{
+    const auto it = mWindows.find(hWnd);
+    if (it != mWindows.end())
+    {
+        if (it->second == title)
+        {
+            return;
+        }
+
+        Erase(hWnd, changed);
+    }
+
+    auto& count = mTitles[title];
+    count += 1;
+
+    if (count == 1)
+    {
+        changed.push_back(title);
+    }
+
+    mWindows.emplace(hWnd, std::move(title));
+    mGeneration += 1;
+}
+
+auto WindowTracker::Erase (HWND hWnd, std::vector<std::wstring>& changed) -> void
+{
+    const auto it = mWindows.find(hWnd);
+    if (it == mWindows.end())
+    {
+        return;
+    }
+
+    const auto titleIt = mTitles.find(it->second);
+    if (titleIt != mTitles.end())
+    {
+        titleIt->second -= 1;
+
+        if (titleIt->second <= 0)
+        {
+            changed.push_back(titleIt->first);
+            mTitles.erase(titleIt);
+        }
+    }
+
+    mWindows.erase(it);
+    mGeneration += 1;
+}
+
+auto WindowTracker::Start (ChangeFn onChange) -> bool
+{
+    if (mIsRunning)
+    {
+        return true;
+    }
+
+    const auto started = mSource->Start(
+        std::bind(&WindowTracker::OnWindowEvent, this, std::placeholders::_1, std::placeholders::_2)
+    );
+
+    if (!started)
+    {
+        LOG_ERROR("Failed to start window tracking, falling back to window scanning");
+        return false;
+    }
+
+    // Initial snapshot. Events received in meantime are applied to live
+    // window state, so it doesn't matter which is processed first.
+    auto indexed = size_t{0};
+    {
+        auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+
+        // No callback yet, caller scans after start anyway.
+        auto changed = std::vector<std::wstring>();
+        ScanWindows(
+            [&](HWND hWnd, DWORD pid, std::wstring_view title)
+            {
+                Insert(hWnd, std::wstring(title), changed);
+                return ScanResult::Continue;
+            }
+        );
+
+        mOnChange = onChange;
+        indexed   = mWindows.size();
+    }
+
+    mIsRunning = true;
+
+    LOG_INFO("Started window tracking, {} windows indexed", indexed);
+
+    return true;
+}
+
+auto WindowTracker::Stop () -> void
+{
+    if (!mIsRunning)
+    {
+        return;
+    }
+
+    mIsRunning = false;
+    mSource->Stop();
+
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    mOnChange = nullptr;
+    mWindows.clear();
+    mTitles.clear();
+    mGeneration += 1;
+
+    LOG_INFO("Stopped window tracking");
+}
+
+auto WindowTracker::Contains (const std::wstring& title) const -> bool
+{
+    auto lockGuard = std::lock_guard<std::mutex>(mMutex);
+    return mTitles.contains(title);
+}
+
+#pragma endregion
+
+#pragma region "ForegroundTracker"
+
+auto ForegroundTracker::OnWindowEvent (WindowEvent event, HWND hWnd) -> void
+{
+    switch (event)
+    {
+    case WindowEvent::Foreground:
+        mForeground = hWnd;
+        break;
+
+    case WindowEvent::LocationChange:
+        if (hWnd != mForeground)
+        {
+            return;
+        }
+        break;
+
+    default:
+        return;
+    }
+
+    const auto isFullscreen = IsWindowFullscreen(hWnd);
+    if (mIsFullscreen.exchange(isFullscreen) != isFullscreen)
+    {
+        if (mOnChange)
+        {
+            mOnChange();
+        }
+    }
+}
+
+auto ForegroundTracker::Start (ChangeFn onChange) -> bool
+{
+    if (mIsRunning)
+    {
+        return true;
+    }
+
+    mOnChange = onChange;
+
+    const auto started = mSource->Start(
+        std::bind(&ForegroundTracker::OnWindowEvent, this, std::placeholders::_1, std::placeholders::_2)
+    );
+
+    if (!started)
+    {
+        LOG_ERROR("Failed to start foreground window tracking");
+        mOnChange = nullptr;
+        return false;
+    }
+
+    mIsRunning = true;
+
+    LOG_INFO("Started foreground window tracking");
+
+    return true;
+}
+
+auto ForegroundTracker::Stop () -> void
+{
+    if (!mIsRunning)
+    {
+        return;
+    }
+
+    mIsRunning = false;
+    mSource->Stop();
+
+    mOnChange     = nullptr;
+    mForeground   = NULL;
+    mIsFullscreen = false;
+
+    LOG_INFO("Stopped foreground window tracking");
+}
+
+#pragma endregion
+
+auto IsWindowFullscreen (HWND hWnd) -> bool
+{
+    if (hWnd == NULL || !IsWindowVisible(hWnd) || IsIconic(hWnd))
+    {
+        return false;
+    }
+
+    // Desktop gets foreground after Win+D.
+    if (hWnd == GetDesktopWindow() || hWnd == GetShellWindow())
+    {
+        return false;
+    }
+
+    auto className = std::array<wchar_t, 16>{ 0 };
+    if (GetClassNameW(hWnd, className.data(), static_cast<int>(className.size())) > 0)
+    {
+        const auto name = std::wstring_view(className.data());
+        if (name == L"WorkerW" || name == L"Progman")
+        {
+            return false;
+        }
+    }
+
+    // Maximized window with caption covers whole monitor when taskbar is
+    // set to auto hide, that's not fullscreen.
+    const auto style = GetWindowLongPtrW(hWnd, GWL_STYLE);
+    if (IsZoomed(hWnd) && (style & WS_CAPTION) == WS_CAPTION)
+    {
+        return false;
+    }
+
+    const auto monitor = MonitorFromWindow(hWnd, MONITOR_DEFAULTTONULL);
+    if (monitor == NULL)
+    {
+        return false;
+    }
+
+    auto monitorInfo = MONITORINFO{};
+    monitorInfo.cbSize = sizeof(monitorInfo);
+    if (!GetMonitorInfoW(monitor, &monitorInfo))
+    {
+        return false;
+    }
+
+    auto rect = RECT{};
+    if (!GetWindowRect(hWnd, &rect))
+    {
+        return false;
+    }
+
+    return rect.left   <= monitorInfo.rcMonitor.left
+        && rect.top    <= monitorInfo.rcMonitor.top
+        && rect.right  >= monitorInfo.rcMonitor.right
+        && rect.bottom >= monitorInfo.rcMonitor.bottom;
+}
+
+} // namespace CaffeineTake
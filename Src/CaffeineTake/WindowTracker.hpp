@@ -0,0 +1,208 @@
+// CaffeineTake - Keep your computer awake.
+// 
+// Copyright (c) 2020-2021 VacuityBox
+// Copyright (c) 2022      serverfailure71
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+namespace CaffeineTake {
+
+enum class WindowEvent : unsigned char
+{
+    Create,
+    Destroy,
+    Show,
+    Hide,
+    NameChange,
+    Foreground,
+    LocationChange
+};
+
+enum class WindowEventGroup : unsigned char
+{
+    Lifetime   = 0x01,  // Create, Destroy, Show, Hide, NameChange
+    Foreground = 0x02   // Foreground, LocationChange (of foreground window process only)
+};
+DEFINE_ENUM_FLAG_OPERATORS(WindowEventGroup);
+
+// Source of top-level window notifications.
+class WindowSource
+{
+public:
+    using EventFn = std::function<void (WindowEvent, HWND)>;
+
+    virtual ~WindowSource() {}
+
+    virtual auto Start (EventFn callback) -> bool = 0;
+    virtual auto Stop  () -> void = 0;
+};
+
+// Window notifications received with SetWinEventHook, hooks are owned by
+// separate thread with it's own message loop.
+class WinEventWindowSource : public WindowSource
+{
+    const WindowEventGroup mGroups;
+    std::thread            mThread;
+    DWORD                  mThreadId     = 0;
+    EventFn                mCallback     = nullptr;
+    HWINEVENTHOOK          mLocationHook = NULL;
+    DWORD                  mLocationPid  = 0;
+
+    auto Worker             (std::promise<bool> started) -> void;
+    auto HookLocationChange (HWND hWnd) -> void;
+
+    static void CALLBACK WinEventProc (
+        HWINEVENTHOOK hWinEventHook,
+        DWORD         event,
+        HWND          hWnd,
+        LONG          idObject,
+        LONG          idChild,
+        DWORD         idEventThread,
+        DWORD         dwmsEventTime
+    );
+
+public:
+    WinEventWindowSource (WindowEventGroup groups = WindowEventGroup::Lifetime)
+        : mGroups (groups)
+    {
+    }
+
+    ~WinEventWindowSource ()
+    {
+        Stop();
+    }
+
+    auto Start (EventFn callback) -> bool override;
+    auto Stop  () -> void override;
+};
+
+// Keeps index of visible top-level window titles up to date, so checking
+// if window exists doesn't require enumerating all windows.
+class WindowTracker
+{
+public:
+    // Title appeared or disappeared, called without tracker lock held.
+    using ChangeFn = std::function<void (std::wstring_view title)>;
+
+private:
+    std::unique_ptr<WindowSource>           mSource;
+    ChangeFn                                mOnChange   = nullptr;
+    mutable std::mutex                      mMutex;
+    std::unordered_map<HWND, std::wstring>  mWindows    = std::unordered_map<HWND, std::wstring>();
+    std::unordered_map<std::wstring, int>   mTitles     = std::unordered_map<std::wstring, int>();
+    std::atomic<unsigned long long>         mGeneration = 0;
+    std::atomic<bool>                       mIsRunning  = false;
+
+    auto OnWindowEvent (WindowEvent event, HWND hWnd) -> void;
+
+    // Titles that appeared or disappeared are added to changed.
+    auto Insert (HWND hWnd, std::wstring title, std::vector<std::wstring>& changed) -> void;
+    auto Erase  (HWND hWnd, std::vector<std::wstring>& changed) -> void;
+
+public:
+    WindowTracker (std::unique_ptr<WindowSource> source = std::make_unique<WinEventWindowSource>())
+        : mSource (std::move(source))
+    {
+    }
+
+    ~WindowTracker ()
+    {
+        Stop();
+    }
+
+    auto Start (ChangeFn onChange) -> bool;
+    auto Stop  () -> void;
+
+    auto IsRunning () const -> bool
+    {
+        return mIsRunning;
+    }
+
+    // Incremented on every change to the title index.
+    auto GetGeneration () const -> unsigned long long
+    {
+        return mGeneration;
+    }
+
+    auto Contains (const std::wstring& title) const -> bool;
+};
+
+// Keeps track of foreground window and whether it covers whole monitor.
+class ForegroundTracker
+{
+public:
+    using ChangeFn = std::function<void ()>;
+
+private:
+    std::unique_ptr<WindowSource> mSource;
+    ChangeFn                      mOnChange     = nullptr;
+    std::atomic<HWND>             mForeground   = NULL;
+    std::atomic<bool>             mIsFullscreen = false;
+    std::atomic<bool>             mIsRunning    = false;
+
+    auto OnWindowEvent (WindowEvent event, HWND hWnd) -> void;
+
+public:
+    ForegroundTracker (std::unique_ptr<WindowSource> source = std::make_unique<WinEventWindowSource>(WindowEventGroup::Foreground))
+        : mSource (std::move(source))
+    {
+    }
+
+    ~ForegroundTracker ()
+    {
+        Stop();
+    }
+
+    auto Start (ChangeFn onChange) -> bool;
+    auto Stop  () -> void;
+
+    auto IsRunning () const -> bool
+    {
+        return mIsRunning;
+    }
+
+    auto GetForegroundWindow () const -> HWND
+    {
+        return mForeground;
+    }
+
+    auto IsFullscreen () const -> bool
+    {
+        return mIsFullscreen;
+    }
+};
+
+// Check if window is visible and covers whole monitor it's on.
+auto IsWindowFullscreen (HWND hWnd) -> bool;
+
+} // namespace CaffeineTake